@@ -5,6 +5,30 @@
 * - Supports immediate loading or lazy loading
 * - Supports explicit/implicit function type specification
 * - Supports one-time batch binding
+* - Compile-time Itanium name mangling for C++ exports (getCpp)
+* - Optional per-library arena allocation (ELF, LoadArenaAllocator)
+* - Immediate binding at load (LoadBindNow)
+* - Background dlclose off the calling thread (LoadDeferredUnload, drainUnloads)
+* - Fast shutdown policy and exit (LoadFastShutdownSafe, fastExit)
+* - Closure thunks: C++ callables as plain C callbacks (makeCallback, Callback)
+* - Host service tables injected at load, no -rdynamic needed (HostServices)
+* - Loader thread owning all dlopen/dlclose work, with priorities (LoaderService)
+* - Predictive preloading from observed load sequences (LoadPredictor)
+* - Call-profiling trampolines with perf map entries (getProfiled)
+* - Binding audit, lazy binding plans and linker ordering files (auditBindings)
+* - Sampling CPU profiler attributing time to loaded libraries (CpuSampler)
+* - Lock-free, signal-safe address-to-symbol index (lookupSymbols)
+* - Single-owner executor for non-thread-safe libraries (LibraryExecutor)
+* - Work-stealing pool and parallel map over exports (parallelMap)
+* - Parallel hook broadcast across plugins with stages and deadline (HookBroadcast)
+* - Batch-twin detection and call coalescing for scalar exports (BatchCall, Coalescer)
+* - Fused, batched stage pipelines across libraries (Pipeline)
+* - SHA-256 verify-on-load with parallel hashing and a hash cache (ExpectedHash)
+* - Startup readahead profiles of resident library pages, keyed by build-id (ReadaheadProfile)
+* - Snapshot and in-place reset of a library's writable state (LibrarySnapshot)
+* - USDT probes at load, resolve, batch bind and unload (SHAREDLIBRARY_NO_USDT to omit)
+* - LD_AUDIT companion module counting ld.so symbol bindings (audit/, bindingStats)
+* - Ordered multi-library search scopes with memoized resolution (LibraryScope)
 *
 * Dependencies:
 * - Windows SDK (>= WinXP SP1)
@@ -27,14 +51,129 @@
 #include <functional>
 #include <memory>
 #include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <thread>
+#include <future>
+#include <condition_variable>
+#include <optional>
+#include <tuple>
+#include <deque>
+#include <iterator>
+#include <array>
+#include <cctype>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
 
 // Platform Specific
 #if defined(_WIN32)
 #include <windows.h>
 #else
 #include <dlfcn.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#define SHAREDLIBRARY_ELF 1
+#include <link.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <cxxabi.h>
+#if defined(__x86_64__) || defined(__aarch64__)
+#define SHAREDLIBRARY_THUNKS 1
+#if !defined(SHAREDLIBRARY_NO_USDT)
+#define SHAREDLIBRARY_USDT 1
+#endif
+#endif
+#endif
+#endif
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#endif
+
+// USDT probes (SystemTap SDT v3 notes: bpftrace usdt:, perf sdt_sharedlibrary:)
+// A probe is a nop plus a .note.stapsdt entry naming its argument locations; a
+// tracer that attaches bumps the probe's semaphore, which gates timing work.
+#if defined(SHAREDLIBRARY_USDT)
+#define SHAREDLIBRARY_SDT_NOTE(name, args) \
+    "990: nop\n" \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+    ".balign 4\n" \
+    ".4byte 992f-991f, 994f-993f, 3\n" \
+    "991: .asciz \"stapsdt\"\n" \
+    "992: .balign 4\n" \
+    "993: .8byte 990b\n" \
+    ".8byte _.stapsdt.base\n" \
+    ".8byte sharedlibrary_" #name "_semaphore\n" \
+    ".asciz \"sharedlibrary\"\n" \
+    ".asciz \"" #name "\"\n" \
+    ".asciz \"" args "\"\n" \
+    "994: .balign 4\n" \
+    ".popsection\n" \
+    ".ifndef _.stapsdt.base\n" \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+    ".weak _.stapsdt.base\n" \
+    ".hidden _.stapsdt.base\n" \
+    "_.stapsdt.base: .space 1\n" \
+    ".size _.stapsdt.base, 1\n" \
+    ".popsection\n" \
+    ".endif\n"
+// Signed arguments are described as -size@location, unsigned ones as size@location
+#define SHAREDLIBRARY_SDT_ARG(n, x) \
+    [_s##n] "n" ((std::is_signed<std::decay_t<decltype(x)>>::value ? 1 : -1) * int(sizeof(std::decay_t<decltype(x)>))), \
+    [_a##n] "nor" (x)
+#define SHAREDLIBRARY_SDT_SEMAPHORE(name) \
+    extern "C" { inline volatile unsigned short sharedlibrary_##name##_semaphore \
+        __attribute__((section(".probes"), used, visibility("hidden"))) = 0; }
+#define SHAREDLIBRARY_PROBE_ENABLED(name) (sharedlibrary_##name##_semaphore != 0)
+#define SHAREDLIBRARY_PROBE2(name, a1, a2) \
+    __asm__ __volatile__(SHAREDLIBRARY_SDT_NOTE(name, "%n[_s1]@%[_a1] %n[_s2]@%[_a2]") \
+        :: SHAREDLIBRARY_SDT_ARG(1, a1), SHAREDLIBRARY_SDT_ARG(2, a2))
+#define SHAREDLIBRARY_PROBE3(name, a1, a2, a3) \
+    __asm__ __volatile__(SHAREDLIBRARY_SDT_NOTE(name, "%n[_s1]@%[_a1] %n[_s2]@%[_a2] %n[_s3]@%[_a3]") \
+        :: SHAREDLIBRARY_SDT_ARG(1, a1), SHAREDLIBRARY_SDT_ARG(2, a2), SHAREDLIBRARY_SDT_ARG(3, a3))
+#define SHAREDLIBRARY_PROBE4(name, a1, a2, a3, a4) \
+    __asm__ __volatile__(SHAREDLIBRARY_SDT_NOTE(name, "%n[_s1]@%[_a1] %n[_s2]@%[_a2] %n[_s3]@%[_a3] %n[_s4]@%[_a4]") \
+        :: SHAREDLIBRARY_SDT_ARG(1, a1), SHAREDLIBRARY_SDT_ARG(2, a2), SHAREDLIBRARY_SDT_ARG(3, a3), SHAREDLIBRARY_SDT_ARG(4, a4))
+#else
+#define SHAREDLIBRARY_SDT_SEMAPHORE(name)
+#define SHAREDLIBRARY_PROBE_ENABLED(name) false
+#define SHAREDLIBRARY_PROBE2(name, a1, a2) ((void)0)
+#define SHAREDLIBRARY_PROBE3(name, a1, a2, a3) ((void)0)
+#define SHAREDLIBRARY_PROBE4(name, a1, a2, a3, a4) ((void)0)
 #endif
 
+SHAREDLIBRARY_SDT_SEMAPHORE(load)               // (path, handle, ns)          whole loadNow()
+SHAREDLIBRARY_SDT_SEMAPHORE(native__load)       // (path, ns)                  dlopen/LoadLibrary only
+SHAREDLIBRARY_SDT_SEMAPHORE(reload)             // (path, generation)          a load after an unload
+SHAREDLIBRARY_SDT_SEMAPHORE(resolve)            // (path, symbol, address, ns) get()/tryGet() hit
+SHAREDLIBRARY_SDT_SEMAPHORE(resolve__miss)      // (path, symbol, ns)          get()/tryGet() miss
+SHAREDLIBRARY_SDT_SEMAPHORE(batch__load)        // (path, count, ns)
+SHAREDLIBRARY_SDT_SEMAPHORE(unload)             // (path, ns)
+
 // Namespace sharedlibrary starts
 namespace sharedlibrary
 {
@@ -49,250 +188,7502 @@ namespace sharedlibrary
     };
 
     /*--------------------------------------------------------------
-     *  SharedLibrary Base Class
+     *  Load modes: opt-in behaviours, combined with bitwise OR
      *--------------------------------------------------------------*/
-    class SharedLibraryBase {
-    public:
-        // Constructor
-        explicit SharedLibraryBase(std::string_view path, bool delayLoad = false) : libPath_(path), delayLoad_(delayLoad) {}
+    enum LoadMode : unsigned {
+        LoadDefault        = 0u,
+        LoadArenaAllocator = 1u << 0,   // Route the library's malloc/new family into a private arena (ELF only)
+        LoadBindNow        = 1u << 1,   // Resolve every relocation at load (RTLD_NOW) instead of on first call
+        LoadDeferredUnload = 1u << 2,   // unload() queues dlclose to a background reaper (POSIX; see drainUnloads)
+        LoadFastShutdownSafe = 1u << 3, // Under ShutdownPolicy::Fast, not unmapped at exit; only its fast-finalize hook runs
+    };
 
-        // Destructor
-        virtual ~SharedLibraryBase() = default;
+    /*--------------------------------------------------------------
+     *  Host service tables
+     *  The host hands each plugin a versioned table of function
+     *  pointers at load, so plugins stay RTLD_LOCAL and call the
+     *  host directly instead of through -rdynamic exports. Plugins
+     *  receive it through either (or both) of:
+     *    const ServiceTable* sharedlibrary_services;          (written)
+     *    int sharedlibrary_init_services(const ServiceTable*); (called, 0 = accept)
+     *  Both structs are plain C layout, so C plugins can mirror them.
+     *--------------------------------------------------------------*/
+    struct ServiceEntry {
+        const char* name;
+        void* fn;
+    };
 
-        // Forbidden Copy
-        SharedLibraryBase(const SharedLibraryBase&) = delete;
-        SharedLibraryBase& operator=(const SharedLibraryBase&) = delete;
+    struct ServiceTable {
+        uint32_t magic;                 // ServiceTableMagic
+        uint32_t size;                  // sizeof(ServiceTable) of the host, for later extension
+        uint32_t version;               // Host API version
+        uint32_t count;
+        const ServiceEntry* entries;    // Sorted by name
+    };
 
-        // Move is okay
-        SharedLibraryBase(SharedLibraryBase&&) noexcept = default;
-        SharedLibraryBase& operator=(SharedLibraryBase&&) noexcept = default;
+    static constexpr uint32_t ServiceTableMagic = 0x53485356u;     // "SHSV"
 
-        // ---------------------------------------------------------
-        //  The public APIs
-        // ---------------------------------------------------------
+#if defined(_WIN32)
+#define SHAREDLIBRARY_VISIBLE __declspec(dllexport)
+#else
+#define SHAREDLIBRARY_VISIBLE __attribute__((visibility("default")))
+#endif
+#define SHAREDLIBRARY_EXPORT extern "C" SHAREDLIBRARY_VISIBLE
 
-        /** Load immediately (Internal) */
-        inline void loadNow() {
-            if (isLoaded()) {
-                return;               // Already loaded
-            }
-            nativeLoad();             // Derive Impl
-            if (!isLoaded()) {
-                throwLastError("loadNow() failed");
-                // Failed
-            }
-        }
+    /** Plugin side: defines the slot the host writes the table into */
+#define SHAREDLIBRARY_SERVICES_SLOT \
+    extern "C" { SHAREDLIBRARY_VISIBLE const ::sharedlibrary::ServiceTable* sharedlibrary_services = nullptr; }
 
-        /** Immediate/Delayed Load (if not yet loaded) */
-        inline void ensureLoaded(){
-            // load Now
-            std::call_once(flag_, [this] { this->loadNow(); });
-        }
+    /** Host side: owns a table and the names in it */
+    class HostServices {
+    public:
+        explicit HostServices(uint32_t version = 1) : version_(version) {}
 
-        /** Directly obtain the underlying handle (platform-dependent) */
-        virtual inline void* nativeHandle() const noexcept = 0;
+        HostServices(const HostServices&) = delete;
+        HostServices& operator=(const HostServices&) = delete;
 
-        /** Offload (Called by Destructor) */
-        inline void unload(){
-            if (isLoaded()) {
-                nativeUnload();    // Derived Impl
-                handle_ = nullptr;
-            }
+        /** Publish a host function under `name` (replaces an earlier one) */
+        template<class _Func>
+        inline HostServices& add(const std::string& name, _Func fn) {
+            static_assert(std::is_pointer_v<_Func> && std::is_function_v<std::remove_pointer_t<_Func>>,
+                          "HostServices::add takes function pointers");
+            std::lock_guard<std::mutex> g(lock_);
+            functions_[name] = reinterpret_cast<void*>(fn);
+            dirty_ = true;
+            return *this;
         }
 
-        /** Is already loaded */
-        inline bool isLoaded() const noexcept { 
-            return handle_ != nullptr; 
+        /** The table handed to plugins; stays valid until the next add() */
+        inline const ServiceTable* table() {
+            std::lock_guard<std::mutex> g(lock_);
+            if (dirty_) {
+                entries_.clear();
+                for (const auto& f : functions_) {      // std::map: already sorted
+                    entries_.push_back(ServiceEntry{ f.first.c_str(), f.second });
+                }
+                table_ = ServiceTable{ ServiceTableMagic, static_cast<uint32_t>(sizeof(ServiceTable)), version_,
+                                       static_cast<uint32_t>(entries_.size()), entries_.data() };
+                dirty_ = false;
+            }
+            return &table_;
         }
 
-        /** Obtaining by explicitly specifying the function type */
-        template<class _Func>
-        inline _Func get(const char* name){
-            ensureLoaded();
-            void* p = rawGetSymbol(name);
-            if (!p) {
-                throwLastError("GetProcAddress", name);
+    private:
+        std::mutex lock_;
+        uint32_t version_;
+        std::map<std::string, void*> functions_;
+        std::vector<ServiceEntry> entries_;
+        ServiceTable table_{};
+        bool dirty_ = true;
+    };
+
+    namespace plugin {
+
+    /** Plugin side: address of a host service, nullptr if absent or the table is not valid */
+    inline void* findService(const ServiceTable* table, const char* name) noexcept {
+        if (!table || table->magic != ServiceTableMagic) {
+            return nullptr;
+        }
+        size_t lo = 0, hi = table->count;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            const int c = std::strcmp(table->entries[mid].name, name);
+            if (c == 0) {
+                return table->entries[mid].fn;
+            }
+            if (c < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
             }
-            return reinterpret_cast<_Func>(p);
         }
+        return nullptr;
+    }
 
-        /** Obtaining by implicitly derivation function type */
-        template<class _Func>
-        inline void get(const char* name, _Func& out){
-            out = get<_Func>(name);
-        }
+    /** Plugin side: typed lookup, resolve once and keep the pointer */
+    template<class _Func>
+    inline _Func service(const ServiceTable* table, const char* name) noexcept {
+        return reinterpret_cast<_Func>(findService(table, name));
+    }
 
-        /** Obtaining in a batch */
-        template<class... Bindings>
-        inline void batchLoad(Bindings&&... bindings) {
-            (batchLoad_one(std::forward<Bindings>(bindings)), ...);
-        }
+    }   // namespace plugin
 
-    protected:
-        /** Low-level APIs that derived classes must implement */
-        virtual inline void nativeLoad() = 0;    // Load the library into memory successfully, and set handle_ to non-null.
-        virtual inline void nativeUnload() = 0;  // Offload
-        virtual inline void* rawGetSymbol(const char* name) = 0; // Returns the address of a function or nullptr
+    /*--------------------------------------------------------------
+     *  Process-wide shutdown policy
+     *  Fast: libraries loaded with LoadFastShutdownSafe are left
+     *  mapped when unloaded on the way out, by fastExit() or by static
+     *  destructors once exit() runs (NODELETE semantics). Before that,
+     *  their optional `void sharedlibrary_fast_finalize()` export runs.
+     *  All others, and every unload() while the process keeps
+     *  running, are still dlclosed in order: leaking the handle,
+     *  arena, descriptor and closures is only free at exit.
+     *--------------------------------------------------------------*/
+    enum class ShutdownPolicy {
+        Orderly,    // Every unload dlcloses (default)
+        Fast        // Safe libraries skip dlclose and destructors
+    };
 
-        /** Error Handler */
-        [[noreturn]] static inline void throwLastError(const char* api, const char* extra = nullptr){
-            std::string msg = std::string(api) + " failed";
-            if (extra) {
-                msg += " – " + std::string(extra);
-            }
-            throw std::runtime_error(msg);
-        }
+    namespace detail {
+    inline std::atomic<ShutdownPolicy>& shutdownPolicy() noexcept {
+        static std::atomic<ShutdownPolicy> policy{ ShutdownPolicy::Orderly };
+        return policy;
+    }
 
-    protected:
-        /** Members */
-        std::string libPath_;    // Raw path (UTF-8 / ANSI)
-        bool delayLoad_;         // Whether to delay loading
-        std::once_flag flag_;    // Flag used for call_once
-        void* handle_ = nullptr; // Platform handle (HMODULE / void*)
+    /** Set by fastExit(), or by exit() once Fast was chosen: the only time safe libraries are left mapped */
+    inline std::atomic<bool>& exiting() noexcept {
+        static std::atomic<bool> flag{ false };
+        return flag;
+    }
+    }   // namespace detail
 
-    private:
-         /** The internal implementation of batchLoad */
-        template<class _Func>
-        inline void batchLoad_one(const _FuncBinding<_Func>& binding) {
-            _Func* p = binding.ptr;
-            *p = get<_Func>(binding.name);
+    inline void setShutdownPolicy(ShutdownPolicy policy) noexcept {
+        detail::shutdownPolicy().store(policy);
+        if (policy == ShutdownPolicy::Fast) {
+            // Runs before the destructors of statics constructed earlier, i.e. the libraries already held
+            static const int registered = std::atexit([] { detail::exiting().store(true); });
+            (void)registered;
         }
+    }
+
+    inline ShutdownPolicy shutdownPolicy() noexcept {
+        return detail::shutdownPolicy().load();
+    }
+
+    /*--------------------------------------------------------------
+     *  Per-library allocation accounting (LoadArenaAllocator)
+     *--------------------------------------------------------------*/
+    struct AllocationStats {
+        size_t bytesInUse = 0;               // Usable bytes currently handed out
+        uint64_t allocations = 0;            // Successful allocations
+        uint64_t frees = 0;                  // Releases of arena blocks
+        size_t reservedBytes = 0;            // Slab bytes currently carved from the arena
+        size_t peakReservedBytes = 0;        // High-water mark of reservedBytes
+        uint64_t fallbackAllocations = 0;    // Requests served by the host allocator (arena exhausted)
     };
 
     /*--------------------------------------------------------------
-     *  SharedLibrary Windows Implementation
+     *  Latency profile of one profiled export (getProfiled)
      *--------------------------------------------------------------*/
-#if defined(_WIN32)
-    // Windows (NT)
-    class SharedLibraryWindows final : public SharedLibraryBase {
+    struct CallProfile {
+        std::string symbol;                                     // Export name
+        uint64_t calls = 0;
+        double totalNs = 0;
+        double meanNs = 0;
+        double p50Ns = 0, p90Ns = 0, p99Ns = 0;                 // Upper bounds of the log2 latency buckets
+        std::vector<std::pair<double, uint64_t>> histogram;     // (bucket upper bound in ns, calls), non-empty buckets only
+    };
+
+    /** One get()/batchLoad() binding as seen by the binding audit */
+    struct BindingUse {
+        std::string symbol;
+        uint64_t calls = 0;
+        bool counted = true;        // false: bound directly (signature not stub-able), calls unknown
+        bool resolved = true;       // false: lazy stub never called, so never looked up
+        uint64_t firstCall = 0;     // Process-wide order of its first call (1 = first), 0: never called
+    };
+
+    /** Dynamic-linker bindings of one object, as counted by the LD_AUDIT module (audit/) */
+    struct LibraryBindingStats {
+        std::string path;
+        uint64_t bindsFrom = 0;         // Symbol bindings this object needed (lazy PLT, or at load with BIND_NOW)
+        uint64_t bindsTo = 0;           // ... that other objects resolved to it
+        uint64_t selfBinds = 0;         // Its own references bound back to itself: protected visibility / -Bsymbolic candidates
+        double searchNs = 0;            // Replayed lookup time of bindsFrom
+        double meanSearchDepth = 0;     // Objects searched per binding
+    };
+
+    namespace detail {
+
+    /** Start of a probe's duration argument; 0 (no clock read) when nobody traces it */
+    inline uint64_t probeStart(bool traced) noexcept {
+        return traced ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count()) | 1 : 0;
+    }
+
+    inline uint64_t probeElapsed(uint64_t start) noexcept {
+        return start ? probeStart(true) - start : 0;
+    }
+
+    /** Small dense index per thread, used to pick counter shards */
+    inline unsigned threadIndex() noexcept {
+        static std::atomic<unsigned> next{ 0 };
+        thread_local unsigned index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    /** Cheapest monotonic tick counter of the platform */
+    inline uint64_t readTicks() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t v;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+        return v;
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    /** Ticks per nanosecond of readTicks(), measured once */
+    inline double ticksPerNs() noexcept {
+        static const double rate = [] {
+#if defined(__aarch64__)
+            uint64_t freq;
+            asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+            return static_cast<double>(freq) / 1e9;
+#else
+            using clock = std::chrono::steady_clock;
+            const auto t0 = clock::now();
+            const uint64_t c0 = readTicks();
+            while (clock::now() - t0 < std::chrono::milliseconds(5)) {}
+            const uint64_t c1 = readTicks();
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count();
+            return ns > 0 ? static_cast<double>(c1 - c0) / static_cast<double>(ns) : 1.0;
+#endif
+        }();
+        return rate;
+    }
+
+    /*--------------------------------------------------------------
+     *  Sharded call counters and log2 latency histogram of one export
+     *--------------------------------------------------------------*/
+    class ProfileSite {
     public:
-        /** Inherited constructor */
-        using SharedLibraryBase::SharedLibraryBase; 
+        static constexpr unsigned Shards = 32;
+        static constexpr unsigned Buckets = 48;        // log2(ticks), the last bucket collects the tail
 
-        /** Returns to the original HMODULE */
-        void* nativeHandle() const noexcept override {
-            return handle_;
-        }
+        ProfileSite(std::string symbol, void* target, void* handler)
+            : symbol_(std::move(symbol)), target_(target), handler_(handler) {}
 
-    protected:
-        /** Native load dll */
-        inline void nativeLoad() override
-        {
-            // Use LoadLibraryExW to allow adding search flags later
-            std::wstring wPath = widenPath(libPath_);
-            // Here we use the most common default flags;
-            // you can also use
-            // LOAD_LIBRARY_SEARCH_APPLICATION_DIR | LOAD_LIBRARY_SEARCH_USER_DIRS
-            HMODULE h = ::LoadLibraryW(wPath.c_str());
-            if (!h) {
-                throwLastError("LoadLibraryW", libPath_.c_str());
-            }
-            handle_ = static_cast<void*>(h);
-        }
+        ~ProfileSite();
 
-        /** Native unload dll */
-        inline void nativeUnload() override
-        {
-            if (handle_){
-                ::FreeLibrary(static_cast<HMODULE>(handle_));
-                handle_ = nullptr;
-            }
+        ProfileSite(const ProfileSite&) = delete;
+        ProfileSite& operator=(const ProfileSite&) = delete;
+
+        inline const std::string& symbol() const noexcept { return symbol_; }
+        inline void* handler() const noexcept { return handler_; }
+        inline void* target() const noexcept { return target_.load(std::memory_order_relaxed); }
+        inline void retarget(void* target) noexcept { target_.store(target, std::memory_order_relaxed); }
+        inline void* stub() const noexcept { return stub_; }
+        inline void setStub(void* stub) noexcept { stub_ = stub; }
+
+        /** Hot path: plain stores into the thread's shard, no locked instructions.
+         *  Threads only share a shard beyond Shards threads, where a racing update may be dropped. */
+        inline void record(uint64_t ticks) noexcept {
+            Shard& s = shards_[threadIndex() % Shards];
+            bump(s.calls, 1);
+            bump(s.ticks, ticks);
+            const unsigned b = 63u - static_cast<unsigned>(__builtin_clzll(ticks | 1));
+            bump(s.buckets[b < Buckets ? b : Buckets - 1], 1);
         }
 
-        /** Native get symbol */
-        inline void* rawGetSymbol(const char* name) override {
-            if (!handle_) {
-                return nullptr;
+        /** Merge the shards into a report */
+        inline CallProfile snapshot() const {
+            CallProfile p;
+            p.symbol = symbol_;
+            uint64_t ticks = 0, buckets[Buckets] = {};
+            for (const Shard& s : shards_) {
+                p.calls += s.calls.load(std::memory_order_relaxed);
+                ticks += s.ticks.load(std::memory_order_relaxed);
+                for (unsigned b = 0; b < Buckets; ++b) {
+                    buckets[b] += s.buckets[b].load(std::memory_order_relaxed);
+                }
             }
-            FARPROC p = ::GetProcAddress(static_cast<HMODULE>(handle_), name);
-            return reinterpret_cast<void*>(p);
+            const double rate = ticksPerNs();
+            p.totalNs = static_cast<double>(ticks) / rate;
+            p.meanNs = p.calls ? p.totalNs / static_cast<double>(p.calls) : 0;
+            uint64_t seen = 0, total = 0;
+            for (uint64_t n : buckets) {
+                total += n;
+            }
+            for (unsigned b = 0; b < Buckets; ++b) {
+                if (!buckets[b]) {
+                    continue;
+                }
+                const double upper = std::ldexp(1.0, static_cast<int>(b) + 1) / rate;
+                p.histogram.emplace_back(upper, buckets[b]);
+                seen += buckets[b];
+                if (!p.p50Ns && seen * 100 >= total * 50) p.p50Ns = upper;
+                if (!p.p90Ns && seen * 100 >= total * 90) p.p90Ns = upper;
+                if (!p.p99Ns && seen * 100 >= total * 99) p.p99Ns = upper;
+            }
+            return p;
         }
 
     private:
-        // Convert UTF-8/ANSI paths to wide characters
-        static inline std::wstring widenPath(const std::string& s){
-            if (s.empty()) {
-                return L"";
-            }
-            int n = ::MultiByteToWideChar(CP_UTF8, 0, s.data(), (int)s.size(), nullptr, 0);
-            std::wstring w(n, L'\0'); // broadcast
-            ::MultiByteToWideChar(CP_UTF8, 0, s.data(), (int)s.size(), &w[0], n);
-            return w;
+        static inline void bump(std::atomic<uint64_t>& c, uint64_t n) noexcept {
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
         }
+
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> calls{ 0 };
+            std::atomic<uint64_t> ticks{ 0 };
+            std::atomic<uint64_t> buckets[Buckets] = {};
+        };
+
+        std::string symbol_;
+        std::atomic<void*> target_;     // Real export
+        void* handler_;                 // Typed forwarding function behind the stub
+        void* stub_ = nullptr;          // Generated trampoline handed to the caller
+        Shard shards_[Shards];
     };
-#else   
-    // POSIX (Linux / macOS / BSD)
 
+    /** Whether a stub can stand in for _Func (false for varargs, non-scalar signatures, no thunk support) */
+    template<class _Func, class = void>
+    struct ThunkSupported : std::false_type {};
+
+#if defined(SHAREDLIBRARY_THUNKS)
     /*--------------------------------------------------------------
-     *  SharedLibrary POSIX Implementation
+     *  W^X code arena: one memfd mapped twice, written through the
+     *  RW view and executed through the RX view
      *--------------------------------------------------------------*/
-    class SharedLibraryPosix final : public SharedLibraryBase {
+    class ExecArena {
     public:
-        using SharedLibraryBase::SharedLibraryBase;
+        static constexpr size_t SlotSize = 32;
+        static constexpr size_t ChunkSize = size_t(64) * 1024;
 
-        /** Returns POSIX Native Handle */
-        void* nativeHandle() const noexcept override {
-            return handle_;
+        static inline ExecArena& instance() {
+            static ExecArena* arena = new ExecArena();     // Stubs may be called during static destruction
+            return *arena;
         }
 
-    protected:
-        /** Native load so */
-        inline void nativeLoad() override
-        {
-            // RTLD_NOW: Resolve Immediately 
-            // RTLD_LAZY: Want delayed resolution
-            // RTLD_LOCAL: Exported to the global table
-            void* h = ::dlopen(libPath_.c_str(), RTLD_LAZY | RTLD_LOCAL);
-            if (!h) {
-                throw std::runtime_error(std::string("dlopen failed: ") + dlerror());
+        /** Copy code into a free slot; returns its executable address */
+        inline void* allocate(const uint8_t* code, size_t size) {
+            if (size > SlotSize) {
+                throw std::runtime_error("ExecArena: stub larger than a slot");
             }
-            handle_ = h;
+            std::lock_guard<std::mutex> g(lock_);
+            char* rx = nullptr;
+            if (!free_.empty()) {
+                rx = free_.back();
+                free_.pop_back();
+            } else {
+                if (chunks_.empty() || chunks_.back().used == ChunkSize) {
+                    chunks_.push_back(newChunk());
+                }
+                Chunk& c = chunks_.back();
+                rx = c.rx + c.used;
+                c.used += SlotSize;
+            }
+            char* rw = writable(rx);
+            std::memcpy(rw, code, size);
+            __builtin___clear_cache(rw, rw + size);
+            __builtin___clear_cache(rx, rx + size);
+            return rx;
         }
 
-        /** Native unload so */
-        inline void nativeUnload() override {
-            if (handle_){
-                ::dlclose(handle_);
-                handle_ = nullptr;
+        /** Return a slot; the caller guarantees nobody still calls it */
+        inline void release(void* stub) noexcept {
+            if (!stub) {
+                return;
             }
+            std::lock_guard<std::mutex> g(lock_);
+            free_.push_back(static_cast<char*>(stub));
         }
 
-        /** Native get symbol */
-        inline void* rawGetSymbol(const char* name) override
-        {
-            if (!handle_) return nullptr;
-            // Clear lasr error
-            ::dlerror();
-            void* p = ::dlsym(handle_, name);
-            const char* err = ::dlerror();
-            if (err) {
-                return nullptr;
+    private:
+        struct Chunk {
+            char* rw;
+            char* rx;
+            size_t used;
+        };
+
+        static inline Chunk newChunk() {
+            const int fd = static_cast<int>(::memfd_create("sharedlibrary-thunks", MFD_CLOEXEC));
+            if (fd < 0) {
+                throw std::runtime_error("memfd_create failed – cannot allocate trampolines");
             }
-            return p;
+            if (::ftruncate(fd, static_cast<off_t>(ChunkSize)) != 0) {
+                ::close(fd);
+                throw std::runtime_error("ftruncate failed – cannot allocate trampolines");
+            }
+            void* rw = ::mmap(nullptr, ChunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            void* rx = ::mmap(nullptr, ChunkSize, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (rw == MAP_FAILED || rx == MAP_FAILED) {
+                if (rw != MAP_FAILED) ::munmap(rw, ChunkSize);
+                if (rx != MAP_FAILED) ::munmap(rx, ChunkSize);
+                throw std::runtime_error("mmap failed – cannot map trampoline arena");
+            }
+            return { static_cast<char*>(rw), static_cast<char*>(rx), 0 };
         }
-    };
 
-#endif   // _WIN32 / POSIX
+        inline char* writable(char* rx) const noexcept {
+            for (const Chunk& c : chunks_) {
+                if (rx >= c.rx && rx < c.rx + ChunkSize) {
+                    return c.rw + (rx - c.rx);
+                }
+            }
+            return nullptr;
+        }
+
+        std::mutex lock_;
+        std::vector<Chunk> chunks_;
+        std::vector<char*> free_;
+    };
 
     /*--------------------------------------------------------------
-     *  SharedLibrary Factory Wrapper
+     *  Context thunks: a stub loads a context pointer into the first
+     *  unused integer argument register and jumps to a typed handler
+     *  declared as R handler(Args..., Context*)
      *--------------------------------------------------------------*/
-    inline std::unique_ptr<SharedLibraryBase> makeSharedLibrary(const std::string& path, bool delayLoad = false) {
-#if defined(_WIN32)
-        // Windows
-        return std::make_unique<SharedLibraryWindows>(path, delayLoad);
+    template<class _T>
+    struct ThunkArg {
+        using T = std::remove_cv_t<_T>;
+        static constexpr bool isFloat = std::is_floating_point_v<T> && sizeof(T) <= 8;
+        static constexpr bool isInt = std::is_reference_v<_T> || ((std::is_integral_v<T> || std::is_enum_v<T>
+            || std::is_pointer_v<T> || std::is_null_pointer_v<T>) && sizeof(T) <= 8);
+    };
+
+    template<>
+    struct ThunkArg<void> {
+        static constexpr bool isFloat = false;
+        static constexpr bool isInt = false;
+    };
+
+    template<class _R, class... _Args>
+    struct ThunkAbi {
+#if defined(__x86_64__)
+        static constexpr unsigned IntRegs = 6;      // rdi rsi rdx rcx r8 r9
 #else
-        return std::make_unique<SharedLibraryPosix>(path, delayLoad);
+        static constexpr unsigned IntRegs = 8;      // x0 .. x7
 #endif
-    }
+        static constexpr unsigned intArgs = (0u + ... + (ThunkArg<_Args>::isInt ? 1u : 0u));
+        static constexpr bool scalarArgs = (true && ... && (ThunkArg<_Args>::isInt || ThunkArg<_Args>::isFloat));
+        static constexpr bool scalarResult = std::is_void_v<_R> || ThunkArg<_R>::isInt || ThunkArg<_R>::isFloat;
+        static constexpr bool supported = scalarArgs && scalarResult && intArgs < IntRegs;
+    };
 
-    /*--------------------------------------------------------------
-     *  SharedLibrary Bind Helper
+    template<class _Func>
+    struct FunctionTraits;
+
+    template<class _R, class... _Args>
+    struct FunctionTraits<_R(*)(_Args...)> {
+        using Abi = ThunkAbi<_R, _Args...>;
+        template<template<class, class...> class _T>
+        using Apply = _T<_R, _Args...>;
+    };
+
+    template<class _R, class... _Args>
+    struct FunctionTraits<_R(*)(_Args...) noexcept> : FunctionTraits<_R(*)(_Args...)> {};
+
+    template<class _Func>
+    struct ThunkSupported<_Func, std::void_t<typename FunctionTraits<_Func>::Abi>>
+        : std::bool_constant<FunctionTraits<_Func>::Abi::supported> {};
+
+    /** Emit a context stub: argument register `reg` <- ctx, then jump to target */
+    inline size_t encodeContextThunk(uint8_t* out, unsigned reg, const void* ctx, const void* target) noexcept {
+        const auto c = reinterpret_cast<uint64_t>(ctx), t = reinterpret_cast<uint64_t>(target);
+#if defined(__x86_64__)
+        static const uint8_t regs[] = { 7, 6, 2, 1, 8, 9 };     // rdi rsi rdx rcx r8 r9
+        const uint8_t r = regs[reg];
+        out[0] = static_cast<uint8_t>(0x48 | (r >> 3));        // REX.W (+B)
+        out[1] = static_cast<uint8_t>(0xB8 | (r & 7));         // movabs r, imm64
+        std::memcpy(out + 2, &c, 8);
+        out[10] = 0x49; out[11] = 0xBB;                         // movabs r11, imm64
+        std::memcpy(out + 12, &t, 8);
+        out[20] = 0x41; out[21] = 0xFF; out[22] = 0xE3;         // jmp r11
+        return 23;
+#else
+        const uint32_t code[4] = {
+            0x58000000u | (4u << 5) | reg,                      // ldr x<reg>, #16
+            0x58000000u | (5u << 5) | 16u,                      // ldr x16, #20
+            0xD61F0200u,                                        // br x16
+            0xD503201Fu,                                        // nop
+        };
+        std::memcpy(out, code, sizeof(code));
+        std::memcpy(out + 16, &c, 8);
+        std::memcpy(out + 24, &t, 8);
+        return 32;
+#endif
+    }
+
+    /** Allocate a stub binding ctx to a typed handler of signature _Func */
+    template<class _Func>
+    inline void* makeContextThunk(const void* ctx, const void* handler) {
+        using Abi = typename FunctionTraits<_Func>::Abi;
+        static_assert(Abi::supported, "Trampolines need scalar arguments/result and a free integer argument register");
+        uint8_t code[ExecArena::SlotSize];
+        const size_t n = encodeContextThunk(code, Abi::intArgs, ctx, handler);
+        return ExecArena::instance().allocate(code, n);
+    }
+
+    /*--------------------------------------------------------------
+     *  /tmp/perf-PID.map registration of generated code
+     *--------------------------------------------------------------*/
+    class PerfMap {
+    public:
+        static inline std::atomic<bool>& enabled() noexcept {
+            static std::atomic<bool> on{ true };
+            return on;
+        }
+
+        static inline void add(const void* addr, size_t size, const std::string& name) noexcept {
+            if (!enabled().load(std::memory_order_relaxed)) {
+                return;
+            }
+            static std::mutex lock;
+            static int fd = -1;
+            static pid_t owner = 0;
+            std::lock_guard<std::mutex> g(lock);
+            const pid_t pid = ::getpid();
+            if (fd < 0 || owner != pid) {       // Reopen after fork
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                char path[64];
+                std::snprintf(path, sizeof(path), "/tmp/perf-%d.map", static_cast<int>(pid));
+                fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+                owner = pid;
+                if (fd < 0) {
+                    return;
+                }
+            }
+            char head[48];
+            const int n = std::snprintf(head, sizeof(head), "%llx %zx ",
+                static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(addr)), size);
+            std::string line(head, static_cast<size_t>(n));
+            line += name;
+            line += '\n';
+            ssize_t w = ::write(fd, line.data(), line.size());
+            (void)w;
+        }
+    };
+
+    /** Typed body of a profiling trampoline */
+    template<class _R, class... _Args>
+    struct ProfiledCall {
+        static _R invoke(_Args... args, ProfileSite* site) {
+            struct Scope {
+                ProfileSite* site;
+                uint64_t start;
+                ~Scope() { site->record(readTicks() - start); }
+            } scope{ site, readTicks() };
+            return reinterpret_cast<_R(*)(_Args...)>(site->target())(args...);
+        }
+    };
+
+    inline ProfileSite::~ProfileSite() {
+        ExecArena::instance().release(stub_);
+    }
+#else
+    inline ProfileSite::~ProfileSite() = default;
+#endif  // SHAREDLIBRARY_THUNKS
+
+    /*--------------------------------------------------------------
+     *  Profiling trampolines owned by one library
+     *--------------------------------------------------------------*/
+    class ProfileTable {
+    public:
+#if defined(SHAREDLIBRARY_THUNKS)
+        /** Trampoline for an export, shared per (symbol, signature) */
+        template<class _Func>
+        inline _Func bind(const std::string& library, const char* name, void* target) {
+            void* handler = reinterpret_cast<void*>(&FunctionTraits<_Func>::template Apply<ProfiledCall>::invoke);
+            std::lock_guard<std::mutex> g(lock_);
+            for (auto& site : sites_) {
+                if (site->handler() == handler && site->symbol() == name) {
+                    site->retarget(target);     // Address moves across unload/reload
+                    return reinterpret_cast<_Func>(site->stub());
+                }
+            }
+            auto site = std::make_unique<ProfileSite>(name, target, handler);
+            site->setStub(makeContextThunk<_Func>(site.get(), handler));
+            const size_t slash = library.find_last_of('/');
+            PerfMap::add(site->stub(), ExecArena::SlotSize,
+                "[profiled] " + library.substr(slash == std::string::npos ? 0 : slash + 1) + "!" + name);
+            sites_.push_back(std::move(site));
+            return reinterpret_cast<_Func>(sites_.back()->stub());
+        }
+#endif
+
+        /** Reports of every trampoline */
+        inline std::vector<CallProfile> snapshot() const {
+            std::lock_guard<std::mutex> g(lock_);
+            std::vector<CallProfile> out;
+            out.reserve(sites_.size());
+            for (const auto& site : sites_) {
+                out.push_back(site->snapshot());
+            }
+            return out;
+        }
+
+    private:
+        mutable std::mutex lock_;
+        std::vector<std::unique_ptr<ProfileSite>> sites_;
+    };
+
+    /*--------------------------------------------------------------
+     *  Binding audit: batchLoad() through counting stubs, and lazy
+     *  stubs that resolve on first call for bindings a previous
+     *  audit found unused
+     *--------------------------------------------------------------*/
+    /** Process-wide order of first calls through binding stubs */
+    inline std::atomic<uint64_t>& firstCallOrder() noexcept {
+        static std::atomic<uint64_t> order{ 0 };
+        return order;
+    }
+
+    struct BindingSite {
+        BindingSite(std::string name, void* target, void* handler, void* owner, void* (*resolver)(void*, const char*))
+            : symbol(std::move(name)), handler(handler), owner(owner), resolver(resolver), target(target) {}
+
+        ~BindingSite() {
+#if defined(SHAREDLIBRARY_THUNKS)
+            ExecArena::instance().release(stub);
+#endif
+        }
+
+        /** Export address, resolved through the owning library on first use */
+        inline void* resolve() {
+            void* t = target.load(std::memory_order_acquire);
+            if (!t) {
+                t = resolver(owner, symbol.c_str());
+                target.store(t, std::memory_order_release);
+            }
+            return t;
+        }
+
+        std::string symbol;
+        void* handler;                          // Typed forwarding function behind the stub
+        void* owner;
+        void* (*resolver)(void*, const char*);
+        std::atomic<void*> target;              // Null until resolved (lazy stubs)
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> firstCall{ 0 };   // firstCallOrder() at the first call, 0 before
+        void* stub = nullptr;
+    };
+
+#if defined(SHAREDLIBRARY_THUNKS)
+    /** Typed body of a binding stub */
+    template<class _R, class... _Args>
+    struct AuditedCall {
+        static _R invoke(_Args... args, BindingSite* site) {
+            if (site->calls.fetch_add(1, std::memory_order_relaxed) == 0) {
+                site->firstCall.store(firstCallOrder().fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            return reinterpret_cast<_R(*)(_Args...)>(site->resolve())(args...);
+        }
+    };
+#endif
+
+    class BindingTable;
+
+    /** Process-wide audit switch, binding plan, and the counts of tables already destroyed */
+    class BindingLedger {
+    public:
+        static inline BindingLedger& instance() {
+            static BindingLedger* ledger = new BindingLedger();
+            return *ledger;
+        }
+
+        inline bool auditing() const noexcept {
+            return auditing_.load(std::memory_order_relaxed);
+        }
+
+        inline void setAuditing(bool on) noexcept {
+            auditing_.store(on, std::memory_order_relaxed);
+        }
+
+        /** library -> symbol -> used in the audited run */
+        inline void setPlan(std::map<std::string, std::map<std::string, bool>> plan) {
+            std::lock_guard<std::mutex> g(lock_);
+            plan_ = std::move(plan);
+            planned_.store(!plan_.empty(), std::memory_order_relaxed);
+        }
+
+        /** 1: used last time, 0: unused, -1: not in the plan */
+        inline int planned(const std::string& library, const char* symbol) const {
+            if (!planned_.load(std::memory_order_relaxed)) {
+                return -1;
+            }
+            std::lock_guard<std::mutex> g(lock_);
+            auto lib = plan_.find(library);
+            if (lib == plan_.end()) {
+                return -1;
+            }
+            auto sym = lib->second.find(symbol);
+            return sym == lib->second.end() ? -1 : sym->second ? 1 : 0;
+        }
+
+        inline void attach(const BindingTable* table) {
+            std::lock_guard<std::mutex> g(lock_);
+            live_.insert(table);
+        }
+
+        inline void detach(const BindingTable* table, const std::string& library, const std::vector<BindingUse>& uses);
+
+        /** Every binding seen so far, per library: live tables plus retired counts */
+        inline std::map<std::string, std::map<std::string, BindingUse>> collect() const;
+
+    private:
+        static inline void merge(std::map<std::string, BindingUse>& into, const std::vector<BindingUse>& uses) {
+            for (const BindingUse& u : uses) {
+                auto it = into.find(u.symbol);
+                if (it == into.end()) {
+                    into.emplace(u.symbol, u);
+                    continue;
+                }
+                it->second.calls += u.calls;
+                it->second.counted = it->second.counted && u.counted;
+                it->second.resolved = it->second.resolved || u.resolved;
+                if (u.firstCall && (!it->second.firstCall || u.firstCall < it->second.firstCall)) {
+                    it->second.firstCall = u.firstCall;
+                }
+            }
+        }
+
+        mutable std::mutex lock_;
+        std::atomic<bool> auditing_{ false };
+        std::atomic<bool> planned_{ false };
+        std::map<std::string, std::map<std::string, bool>> plan_;
+        std::set<const BindingTable*> live_;
+        std::map<std::string, std::map<std::string, BindingUse>> retired_;
+    };
+
+    /** Binding stubs owned by one library */
+    class BindingTable {
+    public:
+        BindingTable() = default;
+        BindingTable(const BindingTable&) = delete;
+        BindingTable& operator=(const BindingTable&) = delete;
+
+        ~BindingTable() {
+            if (attached_) {
+                BindingLedger::instance().detach(this, library_, snapshot());
+            }
+        }
+
+#if defined(SHAREDLIBRARY_THUNKS)
+        /** Stub for an export, shared per (symbol, signature); target may be null to resolve on first call */
+        template<class _Func>
+        inline _Func bind(const std::string& library, const char* name, void* target, void* owner,
+            void* (*resolver)(void*, const char*), bool announce) {
+            void* handler = reinterpret_cast<void*>(&FunctionTraits<_Func>::template Apply<AuditedCall>::invoke);
+            attach(library);
+            std::lock_guard<std::mutex> g(lock_);
+            for (auto& site : sites_) {
+                if (site->handler == handler && site->symbol == name) {
+                    site->target.store(target, std::memory_order_release);     // Null again for a lazy rebind
+                    return reinterpret_cast<_Func>(site->stub);
+                }
+            }
+            auto site = std::make_unique<BindingSite>(name, target, handler, owner, resolver);
+            site->stub = makeContextThunk<_Func>(site.get(), handler);
+            if (announce) {
+                const size_t slash = library.find_last_of('/');
+                PerfMap::add(site->stub, ExecArena::SlotSize,
+                    "[audited] " + library.substr(slash == std::string::npos ? 0 : slash + 1) + "!" + name);
+            }
+            sites_.push_back(std::move(site));
+            return reinterpret_cast<_Func>(sites_.back()->stub);
+        }
+#endif
+
+        /** An audited binding that had to be bound directly: listed, calls unknown */
+        inline void direct(const std::string& library, const char* name) {
+            attach(library);
+            std::lock_guard<std::mutex> g(lock_);
+            if (std::find(direct_.begin(), direct_.end(), name) == direct_.end()) {
+                direct_.emplace_back(name);
+            }
+        }
+
+        /** The library unloaded: every stub resolves again on its next call instead of jumping to the old mapping */
+        inline void forgetTargets() {
+            std::lock_guard<std::mutex> g(lock_);
+            for (auto& site : sites_) {
+                site->target.store(nullptr, std::memory_order_release);
+            }
+        }
+
+        inline std::vector<BindingUse> snapshot() const {
+            std::lock_guard<std::mutex> g(lock_);
+            std::vector<BindingUse> out;
+            out.reserve(sites_.size() + direct_.size());
+            for (const auto& site : sites_) {
+                out.push_back({ site->symbol, site->calls.load(std::memory_order_relaxed), true,
+                    site->target.load(std::memory_order_relaxed) != nullptr, site->firstCall.load(std::memory_order_relaxed) });
+            }
+            for (const std::string& name : direct_) {
+                out.push_back({ name, 0, false, true, 0 });
+            }
+            return out;
+        }
+
+        inline const std::string& library() const noexcept {
+            return library_;
+        }
+
+    private:
+        inline void attach(const std::string& library) {
+            {
+                std::lock_guard<std::mutex> g(lock_);
+                if (attached_) {
+                    return;
+                }
+                attached_ = true;
+                library_ = library;
+            }
+            BindingLedger::instance().attach(this);     // Ledger before table, as in collect()
+        }
+
+        mutable std::mutex lock_;
+        bool attached_ = false;
+        std::string library_;
+        std::vector<std::unique_ptr<BindingSite>> sites_;
+        std::vector<std::string> direct_;
+    };
+
+    inline void BindingLedger::detach(const BindingTable* table, const std::string& library, const std::vector<BindingUse>& uses) {
+        std::lock_guard<std::mutex> g(lock_);
+        live_.erase(table);
+        merge(retired_[library], uses);
+    }
+
+    inline std::map<std::string, std::map<std::string, BindingUse>> BindingLedger::collect() const {
+        std::lock_guard<std::mutex> g(lock_);
+        auto out = retired_;
+        for (const BindingTable* table : live_) {
+            merge(out[table->library()], table->snapshot());
+        }
+        return out;
+    }
+
+    /*--------------------------------------------------------------
+     *  Closure thunks: a C function pointer whose stub passes its
+     *  own box to a handler that calls the stored callable
      *--------------------------------------------------------------*/
+    struct ClosureBase {
+        virtual ~ClosureBase() {
+#if defined(SHAREDLIBRARY_THUNKS)
+            ExecArena::instance().release(stub);
+#endif
+        }
+        void* stub = nullptr;
+    };
+
+    template<class _Fn>
+    struct ClosureOf {
+        template<class _R, class... _Args>
+        struct Box : ClosureBase {
+            explicit Box(_Fn&& f) : fn(std::move(f)) {}
+            static _R invoke(_Args... args, Box* self) {
+                return self->fn(std::forward<_Args>(args)...);
+            }
+            _Fn fn;
+        };
+    };
+
+    /** Box fn behind a fresh stub of signature _Func */
+    template<class _Func, class _Fn>
+    inline std::unique_ptr<ClosureBase> makeClosure(_Fn&& fn) {
+#if defined(SHAREDLIBRARY_THUNKS)
+        using Box = typename FunctionTraits<_Func>::template Apply<ClosureOf<std::decay_t<_Fn>>::template Box>;
+        auto box = std::make_unique<Box>(std::decay_t<_Fn>(std::forward<_Fn>(fn)));
+        box->stub = makeContextThunk<_Func>(box.get(), reinterpret_cast<void*>(&Box::invoke));
+        return box;
+#else
+        (void)fn;
+        throw std::runtime_error("makeCallback failed – trampolines are not supported on this platform");
+#endif
+    }
+
+    /** Closures owned by one library */
+    class ClosureTable {
+    public:
+        using Boxes = std::vector<std::unique_ptr<ClosureBase>>;
+
+        inline void* add(std::unique_ptr<ClosureBase> box) {
+            std::lock_guard<std::mutex> g(lock_);
+            boxes_.push_back(std::move(box));
+            return boxes_.back()->stub;
+        }
+
+        inline bool remove(const void* stub) {
+            std::unique_ptr<ClosureBase> gone;
+            std::lock_guard<std::mutex> g(lock_);
+            for (auto& box : boxes_) {
+                if (box->stub == stub) {
+                    gone = std::move(box);
+                    box = std::move(boxes_.back());
+                    boxes_.pop_back();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Hand every closure over, e.g. to outlive a deferred dlclose */
+        inline std::shared_ptr<Boxes> detach() {
+            std::lock_guard<std::mutex> g(lock_);
+            auto out = std::make_shared<Boxes>(std::move(boxes_));
+            boxes_.clear();
+            return out;
+        }
+
+        inline void clear() {
+            detach();
+        }
+
+        /** Never free: the code holding the pointers is never unmapped */
+        inline void leak() {
+            std::lock_guard<std::mutex> g(lock_);
+            for (auto& box : boxes_) {
+                box.release();
+            }
+            boxes_.clear();
+        }
+
+        inline size_t size() const {
+            std::lock_guard<std::mutex> g(lock_);
+            return boxes_.size();
+        }
+
+    private:
+        mutable std::mutex lock_;
+        Boxes boxes_;
+    };
+
+    }   // namespace detail
+
+    /** A closure thunk not tied to a library: RAII owner of one C callback */
     template<class _Func>
-    _FuncBinding<_Func> bind(const char* name, _Func& out) {
-        return { name, &out };
+    class Callback {
+    public:
+        Callback() = default;
+
+        template<class _Fn>
+        explicit Callback(_Fn&& fn) : box_(detail::makeClosure<_Func>(std::forward<_Fn>(fn))) {}
+
+        /** Plain function pointer; valid while this object lives */
+        inline _Func get() const noexcept {
+            return box_ ? reinterpret_cast<_Func>(box_->stub) : nullptr;
+        }
+
+        explicit operator bool() const noexcept {
+            return box_ != nullptr;
+        }
+
+    private:
+        std::unique_ptr<detail::ClosureBase> box_;
+    };
+
+    /** Toggle /tmp/perf-PID.map entries for generated trampolines (on by default) */
+    inline void setPerfMapEnabled(bool on) noexcept {
+#if defined(SHAREDLIBRARY_THUNKS)
+        detail::PerfMap::enabled().store(on, std::memory_order_relaxed);
+#else
+        (void)on;
+#endif
+    }
+
+#if !defined(_MSC_VER)
+    /*--------------------------------------------------------------
+     *  Itanium C++ name mangling, at compile time
+     *  A signature is first spelled out in full, then rewritten with
+     *  the ABI's substitutions (S_, S0_, ...): every repeated
+     *  non-builtin type or name prefix refers back to its first use.
+     *  Covers free functions in namespaces over builtins, pointers,
+     *  references, cv, arrays, function types and named classes/enums.
+     *--------------------------------------------------------------*/
+
+    /** Qualified source name of a class/enum parameter type; see SHAREDLIBRARY_CPP_TYPE */
+    template<class _Type>
+    struct CppTypeName;
+
+#define SHAREDLIBRARY_CPP_TYPE(...) \
+    template<> struct sharedlibrary::CppTypeName<__VA_ARGS__> { static constexpr const char* value = #__VA_ARGS__; }
+
+#if defined(__cpp_consteval)
+#define SHAREDLIBRARY_CONSTEVAL consteval
+#else
+#define SHAREDLIBRARY_CONSTEVAL constexpr
+#endif
+
+    namespace detail {
+
+    template<size_t _Cap>
+    struct FixedString {
+        char data[_Cap + 1] = {};
+        size_t size = 0;
+
+        constexpr void push(char c) {
+            if (size == _Cap) {
+                throw std::length_error("mangled name too long");
+            }
+            data[size++] = c;
+        }
+        constexpr void append(const char* s, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                push(s[i]);
+            }
+        }
+        constexpr void append(const char* s) {
+            while (*s) {
+                push(*s++);
+            }
+        }
+        constexpr void number(size_t n) {
+            char digits[20] = {};
+            size_t k = 0;
+            do {
+                digits[k++] = char('0' + n % 10);
+                n /= 10;
+            } while (n);
+            while (k) {
+                push(digits[--k]);
+            }
+        }
+        constexpr const char* c_str() const noexcept { return data; }
+    };
+
+    using MangleBuffer = FixedString<1024>;
+
+    /** "a::b::f" -> N1a1b1fE, "f" -> 1f, "std::f" -> St1f (spaces and a leading :: ignored) */
+    constexpr void mangleSourceName(MangleBuffer& out, const char* name) {
+        while (*name == ' ' || *name == ':') {
+            ++name;
+        }
+        const char* parts[32] = {};
+        size_t lens[32] = {};
+        size_t n = 0;
+        for (const char* p = name; *p;) {
+            if (n == 32) {
+                throw std::length_error("name nested too deeply");
+            }
+            parts[n] = p;
+            while (*p && *p != ':' && *p != ' ') {
+                if (*p == '<' || *p == '(' || *p == '~') {
+                    throw std::invalid_argument("only plain identifiers can be mangled");
+                }
+                ++p;
+            }
+            lens[n] = size_t(p - parts[n]);
+            ++n;
+            while (*p == ' ' || *p == ':') {
+                ++p;
+            }
+        }
+        if (n == 0) {
+            throw std::invalid_argument("empty name");
+        }
+        size_t first = 0;
+        const bool inStd = n > 1 && lens[0] == 3 && parts[0][0] == 's' && parts[0][1] == 't' && parts[0][2] == 'd';
+        if (inStd) {
+            first = 1;
+        }
+        const bool nested = n - first > 1;
+        if (nested) {
+            out.push('N');
+        }
+        if (inStd) {
+            out.append("St");
+        }
+        for (size_t i = first; i < n; ++i) {
+            out.number(lens[i]);
+            out.append(parts[i], lens[i]);
+        }
+        if (nested) {
+            out.push('E');
+        }
+    }
+
+    template<class _T> struct IsNoexceptFunction : std::false_type {};
+    template<class _R, class... _Args> struct IsNoexceptFunction<_R(_Args...) noexcept> : std::true_type {};
+    template<class _R, class... _Args> struct IsNoexceptFunction<_R(_Args..., ...) noexcept> : std::true_type {};
+
+    template<class _T> struct FunctionParts;
+    template<class _R, class... _Args> struct FunctionParts<_R(_Args...)> {
+        using Return = _R;
+        using Params = std::tuple<_Args...>;
+        static constexpr bool variadic = false;
+    };
+    template<class _R, class... _Args> struct FunctionParts<_R(_Args..., ...)> {
+        using Return = _R;
+        using Params = std::tuple<_Args...>;
+        static constexpr bool variadic = true;
+    };
+    template<class _R, class... _Args> struct FunctionParts<_R(_Args...) noexcept> : FunctionParts<_R(_Args...)> {};
+    template<class _R, class... _Args> struct FunctionParts<_R(_Args..., ...) noexcept> : FunctionParts<_R(_Args..., ...)> {};
+
+    template<class _T>
+    constexpr void mangleTypeFull(MangleBuffer& out);
+
+    /** Parameter list as it appears in a function encoding: top-level cv dropped, arrays decay */
+    template<class _Tuple, size_t... _I>
+    constexpr void mangleParamsFull(MangleBuffer& out, bool variadic, std::index_sequence<_I...>) {
+        if (sizeof...(_I) == 0 && !variadic) {
+            out.push('v');
+        }
+        (mangleTypeFull<std::conditional_t<std::is_reference_v<std::tuple_element_t<_I, _Tuple>>,
+            std::tuple_element_t<_I, _Tuple>,
+            std::decay_t<std::tuple_element_t<_I, _Tuple>>>>(out), ...);
+        if (variadic) {
+            out.push('z');
+        }
+    }
+
+    template<class _Fn>
+    constexpr void mangleParamsFull(MangleBuffer& out) {
+        using Parts = FunctionParts<_Fn>;
+        using Params = typename Parts::Params;
+        mangleParamsFull<Params>(out, Parts::variadic, std::make_index_sequence<std::tuple_size_v<Params>>());
+    }
+
+#if defined(__SIZEOF_INT128__)
+    /** Spelled once under __extension__ so -Wpedantic builds stay quiet */
+    __extension__ typedef __int128 Int128;
+    __extension__ typedef unsigned __int128 UInt128;
+#endif
+
+    /** Unsubstituted mangling of one type */
+    template<class _T>
+    constexpr void mangleTypeFull(MangleBuffer& out) {
+        using U = std::remove_cv_t<_T>;
+        if constexpr (!std::is_same_v<U, _T>) {
+            if (std::is_volatile_v<_T>) out.push('V');
+            if (std::is_const_v<_T>) out.push('K');
+            mangleTypeFull<U>(out);
+        } else if constexpr (std::is_pointer_v<_T>) {
+            out.push('P');
+            mangleTypeFull<std::remove_pointer_t<_T>>(out);
+        } else if constexpr (std::is_lvalue_reference_v<_T>) {
+            out.push('R');
+            mangleTypeFull<std::remove_reference_t<_T>>(out);
+        } else if constexpr (std::is_rvalue_reference_v<_T>) {
+            out.push('O');
+            mangleTypeFull<std::remove_reference_t<_T>>(out);
+        } else if constexpr (std::is_function_v<_T>) {
+            if (IsNoexceptFunction<_T>::value) out.append("Do");
+            out.push('F');
+            mangleTypeFull<typename FunctionParts<_T>::Return>(out);
+            mangleParamsFull<_T>(out);
+            out.push('E');
+        } else if constexpr (std::is_array_v<_T>) {
+            out.push('A');
+            if (std::extent_v<_T> != 0) out.number(std::extent_v<_T>);
+            out.push('_');
+            mangleTypeFull<std::remove_extent_t<_T>>(out);
+        }
+        else if constexpr (std::is_same_v<_T, void>) out.push('v');
+        else if constexpr (std::is_same_v<_T, bool>) out.push('b');
+        else if constexpr (std::is_same_v<_T, char>) out.push('c');
+        else if constexpr (std::is_same_v<_T, signed char>) out.push('a');
+        else if constexpr (std::is_same_v<_T, unsigned char>) out.push('h');
+        else if constexpr (std::is_same_v<_T, short>) out.push('s');
+        else if constexpr (std::is_same_v<_T, unsigned short>) out.push('t');
+        else if constexpr (std::is_same_v<_T, int>) out.push('i');
+        else if constexpr (std::is_same_v<_T, unsigned>) out.push('j');
+        else if constexpr (std::is_same_v<_T, long>) out.push('l');
+        else if constexpr (std::is_same_v<_T, unsigned long>) out.push('m');
+        else if constexpr (std::is_same_v<_T, long long>) out.push('x');
+        else if constexpr (std::is_same_v<_T, unsigned long long>) out.push('y');
+#if defined(__SIZEOF_INT128__)
+        else if constexpr (std::is_same_v<_T, Int128>) out.push('n');
+        else if constexpr (std::is_same_v<_T, UInt128>) out.push('o');
+#endif
+        else if constexpr (std::is_same_v<_T, float>) out.push('f');
+        else if constexpr (std::is_same_v<_T, double>) out.push('d');
+        else if constexpr (std::is_same_v<_T, long double>) out.push('e');
+        else if constexpr (std::is_same_v<_T, wchar_t>) out.push('w');
+        else if constexpr (std::is_same_v<_T, char16_t>) out.append("Ds");
+        else if constexpr (std::is_same_v<_T, char32_t>) out.append("Di");
+#if defined(__cpp_char8_t)
+        else if constexpr (std::is_same_v<_T, char8_t>) out.append("Du");
+#endif
+        else if constexpr (std::is_same_v<_T, std::nullptr_t>) out.append("Dn");
+        else {
+            mangleSourceName(out, CppTypeName<_T>::value);
+        }
     }
 
+    /** Rewrites a full mangling with substitutions; candidates are keyed by their full spelling */
+    class ItaniumCompressor {
+    public:
+        constexpr explicit ItaniumCompressor(const char* full) : in_(full) {}
+
+        /** in_ holds <name><params>; the function name itself is not a candidate */
+        constexpr MangleBuffer run() {
+            out_.append("_Z");
+            name(false);
+            while (in_[pos_]) {
+                type();
+            }
+            return out_;
+        }
+
+    private:
+        static constexpr bool isBuiltin(char c) {
+            return c == 'v' || c == 'b' || c == 'c' || c == 'a' || c == 'h' || c == 's' || c == 't' || c == 'i' ||
+                c == 'j' || c == 'l' || c == 'm' || c == 'x' || c == 'y' || c == 'n' || c == 'o' || c == 'f' ||
+                c == 'd' || c == 'e' || c == 'w' || c == 'z';
+        }
+
+        static constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+        /** End of the type starting at p */
+        constexpr size_t skip(size_t p) const {
+            const char c = in_[p];
+            if (isBuiltin(c)) return p + 1;
+            if (c == 'D' && in_[p + 1] != 'o') return p + 2;
+            if (c == 'D') return skip(p + 2);
+            if (c == 'r' || c == 'V' || c == 'K' || c == 'P' || c == 'R' || c == 'O') return skip(p + 1);
+            if (c == 'F') {
+                p = skip(p + 1);
+                while (in_[p] != 'E') p = skip(p);
+                return p + 1;
+            }
+            if (c == 'A') {
+                ++p;
+                while (in_[p] != '_') ++p;
+                return skip(p + 1);
+            }
+            if (c == 'N') {
+                ++p;
+                while (in_[p] != 'E') p = skipComponent(p);
+                return p + 1;
+            }
+            return skipComponent(p);
+        }
+
+        constexpr size_t skipComponent(size_t p) const {
+            if (in_[p] == 'S' && in_[p + 1] == 't') return p + 2;
+            size_t len = 0;
+            while (isDigit(in_[p])) len = len * 10 + size_t(in_[p++] - '0');
+            return p + len;
+        }
+
+        constexpr int find(const char* key, size_t n) const {
+            for (size_t i = 0; i < count_; ++i) {
+                if (keyLen_[i] != n) continue;
+                bool same = true;
+                for (size_t k = 0; k < n && same; ++k) same = keys_.data[keyAt_[i] + k] == key[k];
+                if (same) return int(i);
+            }
+            return -1;
+        }
+
+        constexpr void remember(const char* key, size_t n) {
+            if (count_ == 128) throw std::length_error("too many substitutions");
+            keyAt_[count_] = keys_.size;
+            keyLen_[count_] = n;
+            keys_.append(key, n);
+            ++count_;
+        }
+
+        constexpr void substitute(int seq) {
+            out_.push('S');
+            if (seq > 0) {
+                char digits[8] = {};
+                size_t k = 0;
+                for (size_t v = size_t(seq - 1); ; v /= 36) {
+                    const size_t d = v % 36;
+                    digits[k++] = char(d < 10 ? '0' + d : 'A' + d - 10);
+                    if (v < 36) break;
+                }
+                while (k) out_.push(digits[--k]);
+            }
+            out_.push('_');
+        }
+
+        constexpr void type() {
+            const size_t begin = pos_;
+            const char c = in_[pos_];
+            if (isBuiltin(c) || (c == 'D' && in_[pos_ + 1] != 'o')) {
+                const size_t end = skip(pos_);
+                out_.append(in_ + pos_, end - pos_);
+                pos_ = end;
+                return;
+            }
+            if (c == 'N' || c == 'S' || isDigit(c)) {
+                name(true);
+                return;
+            }
+            const size_t end = skip(pos_);
+            const int seq = find(in_ + begin, end - begin);
+            if (seq >= 0) {
+                substitute(seq);
+                pos_ = end;
+                return;
+            }
+            if (c == 'r' || c == 'V' || c == 'K') {
+                while (in_[pos_] == 'r' || in_[pos_] == 'V' || in_[pos_] == 'K') out_.push(in_[pos_++]);
+                type();
+            } else if (c == 'P' || c == 'R' || c == 'O') {
+                out_.push(in_[pos_++]);
+                type();
+            } else if (c == 'A') {
+                while (in_[pos_] != '_') out_.push(in_[pos_++]);
+                out_.push(in_[pos_++]);
+                type();
+            } else {
+                if (c == 'D') {
+                    out_.append("Do");
+                    pos_ += 2;
+                }
+                out_.push(in_[pos_++]);         // F
+                type();
+                while (in_[pos_] != 'E') type();
+                out_.push(in_[pos_++]);
+            }
+            remember(in_ + begin, end - begin);
+        }
+
+        /** Canonical spelling of the first k components, the key of that prefix */
+        constexpr size_t prefixKey(char* key, bool inStd, const size_t* at, const size_t* len, size_t k) const {
+            size_t n = 0;
+            const bool nested = k > 1;
+            if (nested) key[n++] = 'N';
+            if (inStd) { key[n++] = 'S'; key[n++] = 't'; }
+            for (size_t i = 0; i < k; ++i) {
+                for (size_t j = 0; j < len[i]; ++j) key[n++] = in_[at[i] + j];
+            }
+            if (nested) key[n++] = 'E';
+            return n;
+        }
+
+        /** A name: every prefix is a candidate; the whole only when it names a type */
+        constexpr void name(bool isType) {
+            bool inStd = false;
+            size_t at[32] = {}, len[32] = {}, n = 0;
+            const bool nested = in_[pos_] == 'N';
+            if (nested) ++pos_;
+            if (in_[pos_] == 'S' && in_[pos_ + 1] == 't') {
+                inStd = true;
+                pos_ += 2;
+            }
+            while (in_[pos_] && in_[pos_] != 'E' && (nested || n == 0)) {
+                const size_t end = skipComponent(pos_);
+                at[n] = pos_;
+                len[n] = end - pos_;
+                ++n;
+                pos_ = end;
+            }
+            if (nested) ++pos_;
+
+            char key[1024] = {};
+            const size_t usable = isType ? n : n - 1;
+            size_t done = 0;
+            int seq = -1;
+            for (size_t k = usable; k > 0 && seq < 0; --k) {
+                seq = find(key, prefixKey(key, inStd, at, len, k));
+                if (seq >= 0) done = k;
+            }
+            if (done == n) {
+                substitute(seq);
+                return;
+            }
+            const bool wrap = seq >= 0 || n > 1;
+            if (wrap) out_.push('N');
+            if (seq >= 0) {
+                substitute(seq);
+            } else if (inStd) {
+                out_.append("St");
+            }
+            for (size_t k = done; k < n; ++k) {
+                out_.append(in_ + at[k], len[k]);
+                if (k + 1 < n || isType) {
+                    remember(key, prefixKey(key, inStd, at, len, k + 1));
+                }
+            }
+            if (wrap) out_.push('E');
+        }
+
+        const char* in_;
+        size_t pos_ = 0;
+        MangleBuffer out_;
+        FixedString<4096> keys_;
+        size_t keyAt_[128] = {};
+        size_t keyLen_[128] = {};
+        size_t count_ = 0;
+    };
+
+    /** Mangled name of the free function `qualifiedName` of type _Fn */
+    template<class _Fn>
+    constexpr MangleBuffer mangleItanium(const char* qualifiedName) {
+        MangleBuffer full;
+        mangleSourceName(full, qualifiedName);
+        mangleParamsFull<_Fn>(full);
+        return ItaniumCompressor(full.c_str()).run();
+    }
+
+    }   // namespace detail
+
+    /** Itanium-mangled symbol of a free function; built at compile time from a literal (always, in C++20) */
+    template<class _Func>
+    struct CppSymbol {
+        using Function = std::remove_pointer_t<_Func>;
+        static_assert(std::is_function_v<Function>, "CppSymbol needs a function or function pointer type");
+
+        SHAREDLIBRARY_CONSTEVAL CppSymbol(const char* qualifiedName)
+            : mangled(detail::mangleItanium<Function>(qualifiedName)) {}
+
+        constexpr const char* c_str() const noexcept { return mangled.c_str(); }
+
+        detail::MangleBuffer mangled;
+    };
+#endif
+
+    class SharedLibraryBase;
+
+    namespace detail {
+
+#if defined(SHAREDLIBRARY_ELF)
+    inline void indexLibrary(const SharedLibraryBase* owner, const std::string& path, void* handle);
+    inline void unindexLibrary(const SharedLibraryBase* owner);
+
+    /** l_name of a verified load (dlopen'ed through its descriptor); reports use the library path instead */
+    inline bool isDescriptorPath(const char* name) noexcept {
+        return name && std::strncmp(name, "/proc/self/fd/", 14) == 0;
+    }
+#endif
+
+    /** Where loadNow()/unload() go when a LoaderService is installed */
+    struct LoaderRoute {
+        virtual ~LoaderRoute() = default;
+        virtual bool onLoaderThread() const noexcept = 0;
+        virtual void loadOn(SharedLibraryBase& lib) = 0;       // Blocks until done, rethrows
+        virtual void unloadOn(SharedLibraryBase& lib) = 0;
+    };
+
+    inline std::atomic<LoaderRoute*>& loaderRoute() noexcept {
+        static std::atomic<LoaderRoute*> route{ nullptr };
+        return route;
+    }
+
+    /** Calls through the route in flight; an uninstalled service stops only once this drains */
+    inline std::atomic<unsigned>& loaderRouteCalls() noexcept {
+        static std::atomic<unsigned> calls{ 0 };
+        return calls;
+    }
+
+    /** fn(route) unless no route is installed or this is the loader thread; true when routed.
+     *  Counted like notifyLoadObserver(), so quiesceLoaderRoute() sees every call still using the route. */
+    template<class _Fn>
+    inline bool routeToLoader(_Fn&& fn) {
+        if (!loaderRoute().load(std::memory_order_relaxed)) {
+            return false;
+        }
+        struct Call {
+            Call() noexcept { loaderRouteCalls().fetch_add(1); }
+            ~Call() { loaderRouteCalls().fetch_sub(1, std::memory_order_release); }
+        } call;
+        LoaderRoute* route = loaderRoute().load();
+        if (!route || route->onLoaderThread()) {
+            return false;
+        }
+        fn(*route);
+        return true;
+    }
+
+    /** Wait until no thread is inside a routed call; call after uninstalling */
+    inline void quiesceLoaderRoute() noexcept {
+        while (loaderRouteCalls().load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    /** Sees successful loads and lookups when a LoadPredictor is installed */
+    struct LoadObserver {
+        virtual ~LoadObserver() = default;
+        virtual void onLoad(const SharedLibraryBase& lib) = 0;
+        virtual void onResolve(const SharedLibraryBase& lib, const char* symbol) = 0;
+    };
+
+    inline std::atomic<LoadObserver*>& loadObserver() noexcept {
+        static std::atomic<LoadObserver*> observer{ nullptr };
+        return observer;
+    }
+
+    /** Calls into an observer in flight; an uninstalled observer is destroyed only once this drains */
+    inline std::atomic<unsigned>& loadObserverCalls() noexcept {
+        static std::atomic<unsigned> calls{ 0 };
+        return calls;
+    }
+
+    /** fn(observer) if one is installed. The count goes up before the pointer is read (both seq_cst),
+     *  so quiesceLoadObserver() after clearing the pointer sees every call that may still use it. */
+    template<class _Fn>
+    inline void notifyLoadObserver(_Fn&& fn) {
+        if (!loadObserver().load(std::memory_order_relaxed)) {
+            return;
+        }
+        struct Call {
+            Call() noexcept { loadObserverCalls().fetch_add(1); }
+            ~Call() { loadObserverCalls().fetch_sub(1, std::memory_order_release); }
+        } call;
+        if (LoadObserver* observer = loadObserver().load()) {
+            fn(*observer);
+        }
+    }
+
+    /** Wait until no thread is inside an observer callback; call after uninstalling */
+    inline void quiesceLoadObserver() noexcept {
+        while (loadObserverCalls().load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    /*--------------------------------------------------------------
+     *  Process-wide registry of loaded SharedLibraryBase objects
+     *--------------------------------------------------------------*/
+    class LibraryRegistry {
+    public:
+        struct Entry {
+            const SharedLibraryBase* owner;
+            std::string path;
+            void* handle;
+            uintptr_t begin, end;       // Mapped image range (ELF), 0/0 elsewhere
+            uint64_t sequence;          // Load order
+        };
+
+        static inline LibraryRegistry& instance() {
+            static LibraryRegistry* registry = new LibraryRegistry();     // Outlives static destructors
+            return *registry;
+        }
+
+        inline void add(const SharedLibraryBase* owner, const std::string& path, void* handle) {
+            Entry e{ owner, path, handle, 0, 0, 0 };
+            imageRange(handle, e.begin, e.end);
+            {
+                std::lock_guard<std::mutex> g(lock_);
+                e.sequence = ++sequence_;
+                entries_.push_back(std::move(e));
+            }
+#if defined(SHAREDLIBRARY_ELF)
+            indexLibrary(owner, path, handle);
+#endif
+        }
+
+        inline void remove(const SharedLibraryBase* owner) {
+#if defined(SHAREDLIBRARY_ELF)
+            unindexLibrary(owner);
+#endif
+            std::lock_guard<std::mutex> g(lock_);
+            for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+                if (it->owner == owner) {
+                    entries_.erase(it);
+                    return;
+                }
+            }
+        }
+
+        inline std::vector<Entry> snapshot() const {
+            std::lock_guard<std::mutex> g(lock_);
+            return entries_;
+        }
+
+        /** Address range covered by the PT_LOAD segments of a loaded object */
+        static inline bool imageRange(void* handle, uintptr_t& begin, uintptr_t& end) noexcept {
+            begin = end = 0;
+#if defined(SHAREDLIBRARY_ELF)
+            struct link_map* lm = nullptr;
+            if (::dlinfo(handle, RTLD_DI_LINKMAP, &lm) != 0 || !lm) {
+                return false;
+            }
+            struct Query { const void* dynamic; uintptr_t begin, end; } q{ lm->l_ld, 0, 0 };
+            ::dl_iterate_phdr([](struct dl_phdr_info* info, size_t, void* data) -> int {
+                auto* q = static_cast<Query*>(data);
+                bool same = false;
+                uintptr_t lo = UINTPTR_MAX, hi = 0;
+                for (unsigned i = 0; i < info->dlpi_phnum; ++i) {
+                    const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+                    if (ph.p_type == PT_DYNAMIC && info->dlpi_addr + ph.p_vaddr == reinterpret_cast<uintptr_t>(q->dynamic)) {
+                        same = true;
+                    } else if (ph.p_type == PT_LOAD) {
+                        lo = std::min<uintptr_t>(lo, info->dlpi_addr + ph.p_vaddr);
+                        hi = std::max<uintptr_t>(hi, info->dlpi_addr + ph.p_vaddr + ph.p_memsz);
+                    }
+                }
+                if (!same) {
+                    return 0;
+                }
+                q->begin = lo;
+                q->end = hi;
+                return 1;
+            }, &q);
+            begin = q.begin;
+            end = q.end;
+            return end > begin;
+#else
+            (void)handle;
+            return false;
+#endif
+        }
+
+    private:
+        mutable std::mutex lock_;
+        std::vector<Entry> entries_;
+        uint64_t sequence_ = 0;
+    };
+
+#if defined(SHAREDLIBRARY_ELF)
+    /*--------------------------------------------------------------
+     *  Address-to-symbol index of one loaded library
+     *  Function and object symbols from .dynsym (in memory) and from
+     *  .symtab (section headers of the file on disk), sorted by start.
+     *--------------------------------------------------------------*/
+    class SymbolIndex {
+    public:
+        struct Symbol {
+            uintptr_t start;
+            size_t size;
+            uint32_t name;              // Offset into names_
+        };
+
+        SymbolIndex(const SharedLibraryBase* owner, const std::string& path, void* handle) : owner_(owner) {
+            struct link_map* lm = nullptr;
+            if (::dlinfo(handle, RTLD_DI_LINKMAP, &lm) != 0 || !lm) {
+                return;
+            }
+            LibraryRegistry::imageRange(handle, begin_, end_);
+            const std::string image = (lm->l_name && *lm->l_name) ? lm->l_name : "/proc/self/exe";
+            path_ = isDescriptorPath(lm->l_name) ? path : image;
+            const uintptr_t base = lm->l_addr;
+            names_.push_back('\0');
+            addDynsym(lm, base);
+            addSymtab(base, image);
+            finish();
+        }
+
+        inline const SharedLibraryBase* owner() const noexcept { return owner_; }
+        inline uintptr_t begin() const noexcept { return begin_; }
+        inline uintptr_t end() const noexcept { return end_; }
+        inline const char* path() const noexcept { return path_.c_str(); }
+        inline size_t size() const noexcept { return symbols_.size(); }
+
+        /** Symbol containing addr, or nullptr; async-signal-safe */
+        inline const Symbol* find(uintptr_t addr) const noexcept {
+            size_t lo = 0, hi = symbols_.size();
+            while (lo < hi) {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (symbols_[mid].start <= addr) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo == 0) {
+                return nullptr;
+            }
+            const Symbol& s = symbols_[lo - 1];
+            return addr - s.start < s.size ? &s : nullptr;
+        }
+
+        inline const char* name(const Symbol& s) const noexcept { return names_.data() + s.name; }
+
+    private:
+        static inline bool wanted(const ElfW(Sym)& s) noexcept {
+            const unsigned type = ELF64_ST_TYPE(s.st_info);
+            return s.st_shndx != SHN_UNDEF && s.st_value != 0 && s.st_name != 0
+                && (type == STT_FUNC || type == STT_GNU_IFUNC || type == STT_OBJECT);
+        }
+
+        inline void push(uintptr_t start, size_t size, const char* name) {
+            symbols_.push_back({ start, size, static_cast<uint32_t>(names_.size()) });
+            names_.append(name);
+            names_.push_back('\0');
+        }
+
+        // .dynsym has no size of its own; the hash tables bound the symbol count
+        inline void addDynsym(const struct link_map* lm, uintptr_t base) {
+            const ElfW(Sym)* symtab = nullptr;
+            const char* strtab = nullptr;
+            const uint32_t* hash = nullptr;
+            const uint32_t* gnuHash = nullptr;
+            auto fix = [base](ElfW(Addr) p) { return p < base ? p + base : p; };
+            for (const ElfW(Dyn)* d = lm->l_ld; d->d_tag != DT_NULL; ++d) {
+                switch (d->d_tag) {
+                case DT_SYMTAB:   symtab = reinterpret_cast<const ElfW(Sym)*>(fix(d->d_un.d_ptr)); break;
+                case DT_STRTAB:   strtab = reinterpret_cast<const char*>(fix(d->d_un.d_ptr)); break;
+                case DT_HASH:     hash = reinterpret_cast<const uint32_t*>(fix(d->d_un.d_ptr)); break;
+                case DT_GNU_HASH: gnuHash = reinterpret_cast<const uint32_t*>(fix(d->d_un.d_ptr)); break;
+                default: break;
+                }
+            }
+            if (!symtab || !strtab) {
+                return;
+            }
+            size_t count = 0;
+            if (hash) {
+                count = hash[1];        // nchain
+            } else if (gnuHash) {
+                const uint32_t nbuckets = gnuHash[0], symoffset = gnuHash[1], bloomSize = gnuHash[2];
+                const auto* buckets = reinterpret_cast<const uint32_t*>(
+                    reinterpret_cast<const ElfW(Addr)*>(gnuHash + 4) + bloomSize);
+                const uint32_t* chain = buckets + nbuckets;
+                uint32_t last = 0;
+                for (uint32_t b = 0; b < nbuckets; ++b) {
+                    last = std::max(last, buckets[b]);
+                }
+                if (last >= symoffset) {
+                    while (!(chain[last - symoffset] & 1u)) {
+                        ++last;
+                    }
+                    count = last + 1;
+                }
+            }
+            for (size_t i = 1; i < count; ++i) {
+                if (wanted(symtab[i])) {
+                    push(base + symtab[i].st_value, symtab[i].st_size, strtab + symtab[i].st_name);
+                }
+            }
+        }
+
+        // .symtab is not loaded; read it from the file when it was not stripped
+        inline void addSymtab(uintptr_t base, const std::string& image) {
+            const int fd = ::open(image.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            struct stat st;
+            void* map = MAP_FAILED;
+            if (::fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(ElfW(Ehdr)))) {
+                map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            ::close(fd);
+            if (map == MAP_FAILED) {
+                return;
+            }
+            const auto* file = static_cast<const unsigned char*>(map);
+            const auto fileSize = static_cast<size_t>(st.st_size);
+            const auto* eh = reinterpret_cast<const ElfW(Ehdr)*>(file);
+            const bool valid = std::memcmp(eh->e_ident, ELFMAG, SELFMAG) == 0
+                && eh->e_ident[EI_CLASS] == (sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32)
+                && eh->e_shentsize == sizeof(ElfW(Shdr))
+                && eh->e_shoff + size_t(eh->e_shnum) * sizeof(ElfW(Shdr)) <= fileSize;
+            if (valid) {
+                const auto* sh = reinterpret_cast<const ElfW(Shdr)*>(file + eh->e_shoff);
+                for (unsigned i = 0; i < eh->e_shnum; ++i) {
+                    if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum) {
+                        continue;
+                    }
+                    const ElfW(Shdr)& strs = sh[sh[i].sh_link];
+                    if (sh[i].sh_offset + sh[i].sh_size > fileSize || strs.sh_offset + strs.sh_size > fileSize) {
+                        continue;
+                    }
+                    const auto* syms = reinterpret_cast<const ElfW(Sym)*>(file + sh[i].sh_offset);
+                    const auto* names = reinterpret_cast<const char*>(file + strs.sh_offset);
+                    for (size_t k = 1, n = sh[i].sh_size / sizeof(ElfW(Sym)); k < n; ++k) {
+                        if (wanted(syms[k]) && syms[k].st_name < strs.sh_size
+                            && std::memchr(names + syms[k].st_name, '\0', strs.sh_size - syms[k].st_name)) {
+                            push((eh->e_type == ET_DYN ? base : 0) + syms[k].st_value, syms[k].st_size, names + syms[k].st_name);
+                        }
+                    }
+                }
+            }
+            ::munmap(map, fileSize);
+        }
+
+        // Sort, keep the first name per address (.dynsym wins), give unsized symbols the gap to the next one
+        inline void finish() {
+            std::stable_sort(symbols_.begin(), symbols_.end(), [](const Symbol& a, const Symbol& b) { return a.start < b.start; });
+            symbols_.erase(std::unique(symbols_.begin(), symbols_.end(),
+                [](const Symbol& a, const Symbol& b) { return a.start == b.start; }), symbols_.end());
+            for (size_t i = 0; i < symbols_.size(); ++i) {
+                if (symbols_[i].size == 0) {
+                    const uintptr_t next = i + 1 < symbols_.size() ? symbols_[i + 1].start : end_;
+                    symbols_[i].size = next > symbols_[i].start ? next - symbols_[i].start : 1;
+                }
+            }
+            symbols_.shrink_to_fit();
+        }
+
+        const SharedLibraryBase* owner_;
+        std::string path_;
+        uintptr_t begin_ = 0, end_ = 0;
+        std::vector<Symbol> symbols_;
+        std::string names_;
+    };
+
+    /*--------------------------------------------------------------
+     *  Process-wide symbol index
+     *  Readers pin one of two epoch counters and read an immutable
+     *  snapshot: no locks, no allocation, safe in signal handlers.
+     *  Writers publish a new snapshot, flip the epoch and wait for the
+     *  old epoch's readers before freeing what was replaced.
+     *--------------------------------------------------------------*/
+    class SymbolIndexTable {
+    public:
+        struct Snapshot {
+            std::vector<const SymbolIndex*> libs;       // Sorted by begin()
+        };
+
+        /** Pinned snapshot for the duration of a scope */
+        class Reader {
+        public:
+            explicit Reader(SymbolIndexTable& t) noexcept : t_(t) {
+                for (;;) {
+                    parity_ = t_.epoch_.load() & 1u;
+                    t_.readers_[parity_].fetch_add(1);
+                    if ((t_.epoch_.load() & 1u) == parity_) {
+                        break;
+                    }
+                    t_.readers_[parity_].fetch_sub(1);
+                }
+                snap_ = t_.current_.load();
+            }
+            ~Reader() { t_.readers_[parity_].fetch_sub(1); }
+
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+
+            inline const Snapshot* snapshot() const noexcept { return snap_; }
+
+        private:
+            SymbolIndexTable& t_;
+            unsigned parity_ = 0;
+            const Snapshot* snap_ = nullptr;
+        };
+
+        static inline SymbolIndexTable& instance() {
+            static SymbolIndexTable* table = new SymbolIndexTable();   // Read from signal handlers until exit
+            return *table;
+        }
+
+        inline bool enabled() const noexcept { return enabled_.load(std::memory_order_acquire); }
+        inline void enable() noexcept { enabled_.store(true, std::memory_order_release); }
+
+        /** Publish a library's index (no-op when already present) */
+        inline void add(std::unique_ptr<SymbolIndex> index) {
+            if (!index || index->end() <= index->begin()) {
+                return;
+            }
+            std::lock_guard<std::mutex> g(writer_);
+            const Snapshot* old = current_.load();
+            auto next = std::make_unique<Snapshot>();
+            if (old) {
+                for (const SymbolIndex* lib : old->libs) {
+                    if (lib->owner() == index->owner()) {
+                        return;
+                    }
+                }
+                next->libs = old->libs;
+            }
+            const SymbolIndex* raw = index.release();
+            next->libs.insert(std::upper_bound(next->libs.begin(), next->libs.end(), raw,
+                [](const SymbolIndex* a, const SymbolIndex* b) { return a->begin() < b->begin(); }), raw);
+            publish(std::move(next), nullptr);
+        }
+
+        /** Withdraw a library's index, freeing it after the grace period */
+        inline void remove(const SharedLibraryBase* owner) {
+            std::lock_guard<std::mutex> g(writer_);
+            const Snapshot* old = current_.load();
+            if (!old) {
+                return;
+            }
+            auto next = std::make_unique<Snapshot>();
+            const SymbolIndex* gone = nullptr;
+            for (const SymbolIndex* lib : old->libs) {
+                if (lib->owner() == owner) {
+                    gone = lib;
+                } else {
+                    next->libs.push_back(lib);
+                }
+            }
+            if (gone) {
+                publish(std::move(next), gone);
+            }
+        }
+
+    private:
+        // Caller holds writer_
+        inline void publish(std::unique_ptr<Snapshot> next, const SymbolIndex* retired) {
+            const Snapshot* old = current_.exchange(next.release());
+            const unsigned parity = epoch_.fetch_add(1) & 1u;
+            while (readers_[parity].load() != 0) {
+                std::this_thread::yield();
+            }
+            delete old;
+            delete retired;
+        }
+
+        std::atomic<bool> enabled_{ false };
+        std::atomic<const Snapshot*> current_{ nullptr };
+        std::atomic<unsigned> epoch_{ 0 };
+        std::atomic<int> readers_[2] = {};
+        std::mutex writer_;
+    };
+
+    inline void indexLibrary(const SharedLibraryBase* owner, const std::string& path, void* handle) {
+        SymbolIndexTable& table = SymbolIndexTable::instance();
+        if (table.enabled()) {
+            table.add(std::make_unique<SymbolIndex>(owner, path, handle));
+        }
+    }
+
+    inline void unindexLibrary(const SharedLibraryBase* owner) {
+        SymbolIndexTable& table = SymbolIndexTable::instance();
+        if (table.enabled()) {
+            table.remove(owner);
+        }
+    }
+#endif  // SHAREDLIBRARY_ELF
+
+    }   // namespace detail
+
+#if defined(SHAREDLIBRARY_ELF)
+    /*--------------------------------------------------------------
+     *  Address-to-symbol lookups over every loaded SharedLibraryBase
+     *--------------------------------------------------------------*/
+    struct SymbolInfo {
+        const char* library = nullptr;      // Path of the loaded object
+        const char* symbol = nullptr;       // Raw (mangled) symbol name
+        uintptr_t address = 0;              // Symbol start
+        size_t size = 0;
+        size_t offset = 0;                  // Queried address - start
+    };
+
+    /** Start indexing: current libraries now, later ones as they load. Not signal-safe. */
+    inline void enableSymbolIndex() {
+        detail::SymbolIndexTable& table = detail::SymbolIndexTable::instance();
+        table.enable();
+        for (const auto& e : detail::LibraryRegistry::instance().snapshot()) {
+            table.add(std::make_unique<detail::SymbolIndex>(e.owner, e.path, e.handle));
+        }
+    }
+
+    /** Symbolize a batch of addresses; returns how many resolved. Lock-free and async-signal-safe.
+     *  Results stay valid while their library stays loaded. */
+    inline size_t lookupSymbols(const void* const* addrs, size_t n, SymbolInfo* out) noexcept {
+        detail::SymbolIndexTable::Reader reader(detail::SymbolIndexTable::instance());
+        const detail::SymbolIndexTable::Snapshot* snap = reader.snapshot();
+        size_t found = 0;
+        const detail::SymbolIndex* last = nullptr;
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = SymbolInfo();
+            const auto a = reinterpret_cast<uintptr_t>(addrs[i]);
+            if (!snap) {
+                continue;
+            }
+            const detail::SymbolIndex* lib = (last && a >= last->begin() && a < last->end()) ? last : nullptr;
+            if (!lib) {
+                size_t lo = 0, hi = snap->libs.size();
+                while (lo < hi) {
+                    const size_t mid = lo + (hi - lo) / 2;
+                    if (snap->libs[mid]->begin() <= a) {
+                        lo = mid + 1;
+                    } else {
+                        hi = mid;
+                    }
+                }
+                if (lo == 0 || a >= snap->libs[lo - 1]->end()) {
+                    continue;
+                }
+                lib = last = snap->libs[lo - 1];
+            }
+            out[i].library = lib->path();
+            if (const detail::SymbolIndex::Symbol* s = lib->find(a)) {
+                out[i].symbol = lib->name(*s);
+                out[i].address = s->start;
+                out[i].size = s->size;
+                out[i].offset = a - s->start;
+                ++found;
+            }
+        }
+        return found;
+    }
+
+    /** Symbolize one address */
+    inline bool lookupSymbol(const void* addr, SymbolInfo& out) noexcept {
+        return lookupSymbols(&addr, 1, &out) == 1;
+    }
+#endif  // SHAREDLIBRARY_ELF
+
+
+    /*--------------------------------------------------------------
+     *  SharedLibrary Base Class
+     *--------------------------------------------------------------*/
+    class SharedLibraryBase {
+    public:
+        // Constructor
+        explicit SharedLibraryBase(std::string_view path, bool delayLoad = false, unsigned mode = LoadDefault)
+            : libPath_(path), delayLoad_(delayLoad), mode_(mode) {}
+
+        // Destructor
+        virtual ~SharedLibraryBase() = default;
+
+        // Forbidden Copy
+        SharedLibraryBase(const SharedLibraryBase&) = delete;
+        SharedLibraryBase& operator=(const SharedLibraryBase&) = delete;
+
+        // Move is okay
+        SharedLibraryBase(SharedLibraryBase&&) noexcept = default;
+        SharedLibraryBase& operator=(SharedLibraryBase&&) noexcept = default;
+
+        // ---------------------------------------------------------
+        //  The public APIs
+        // ---------------------------------------------------------
+
+        /** Load immediately (Internal) */
+        inline void loadNow() {
+            if (isLoaded()) {
+                return;               // Already loaded
+            }
+            if (detail::routeToLoader([this](detail::LoaderRoute& route) { route.loadOn(*this); })) {
+                return;
+            }
+            const uint64_t traceStart = detail::probeStart(SHAREDLIBRARY_PROBE_ENABLED(load) || SHAREDLIBRARY_PROBE_ENABLED(native__load));
+            nativeLoad();             // Derive Impl
+            if (!isLoaded()) {
+                throwLastError("loadNow() failed");
+                // Failed
+            }
+            SHAREDLIBRARY_PROBE2(native__load, libPath_.c_str(), detail::probeElapsed(traceStart));
+            detail::LibraryRegistry::instance().add(this, libPath_, handle_);
+            const uint64_t generation = generation_.fetch_add(1, std::memory_order_release) + 1;
+            if (generation > 1) {
+                SHAREDLIBRARY_PROBE2(reload, libPath_.c_str(), generation);
+            }
+            if (services_) {
+                injectServices();
+            }
+            detail::notifyLoadObserver([this](detail::LoadObserver& observer) { observer.onLoad(*this); });
+            SHAREDLIBRARY_PROBE3(load, libPath_.c_str(), handle_, detail::probeElapsed(traceStart));
+        }
+
+        /** Path the library was created with */
+        inline const std::string& path() const noexcept {
+            return libPath_;
+        }
+
+        /** Hand `table` to the plugin now if loaded, else right after it loads; throws if the plugin refuses */
+        inline void provideServices(const ServiceTable* table) {
+            services_ = table;
+            if (isLoaded() && table) {
+                injectServices();
+            }
+        }
+
+        /** Immediate/Delayed Load (if not yet loaded) */
+        inline void ensureLoaded(){
+            // load Now
+            std::call_once(flag_, [this] { this->loadNow(); });
+        }
+
+        /** Directly obtain the underlying handle (platform-dependent) */
+        virtual inline void* nativeHandle() const noexcept = 0;
+
+        /** Offload (Called by Destructor) */
+        inline void unload(){
+            if (isLoaded()) {
+                if (detail::routeToLoader([this](detail::LoaderRoute& route) { route.unloadOn(*this); })) {
+                    return;
+                }
+                const uint64_t traceStart = detail::probeStart(SHAREDLIBRARY_PROBE_ENABLED(unload));
+                detail::LibraryRegistry::instance().remove(this);
+                if ((mode_ & LoadFastShutdownSafe) && shutdownPolicy() == ShutdownPolicy::Fast && detail::exiting().load()) {
+                    fastFinalize();
+                    closures_.leak();
+                } else {
+                    nativeUnload();    // Derived Impl
+                    closures_.clear();
+                }
+                handle_ = nullptr;
+                bindings_.forgetTargets();
+                generation_.fetch_add(1, std::memory_order_release);
+                SHAREDLIBRARY_PROBE2(unload, libPath_.c_str(), detail::probeElapsed(traceStart));
+            }
+        }
+
+        /** Run the library's optional `void sharedlibrary_fast_finalize()` export */
+        inline void fastFinalize() {
+            if (isLoaded()) {
+                if (auto fn = reinterpret_cast<void(*)()>(rawGetSymbol("sharedlibrary_fast_finalize"))) {
+                    fn();
+                }
+            }
+        }
+
+        /** Is already loaded */
+        inline bool isLoaded() const noexcept { 
+            return handle_ != nullptr; 
+        }
+
+        /** Bumped by every load and unload: state taken from one loaded instance is stale once it moves */
+        inline uint64_t generation() const noexcept {
+            return generation_.load(std::memory_order_acquire);
+        }
+
+        /** Load modes this library was created with */
+        inline unsigned mode() const noexcept {
+            return mode_;
+        }
+
+        /** Allocation accounting; zeroes unless created with LoadArenaAllocator */
+        virtual inline AllocationStats allocationStats() const noexcept {
+            return {};
+        }
+
+        /** Obtaining by explicitly specifying the function type (a counting stub while auditBindings is on) */
+        template<class _Func>
+        inline _Func get(const char* name){
+            _Func fn = getDirect<_Func>(name);
+#if defined(SHAREDLIBRARY_THUNKS)
+            if constexpr (detail::ThunkSupported<_Func>::value) {
+                if (detail::BindingLedger::instance().auditing()) {
+                    return bindings_.bind<_Func>(libPath_, name, reinterpret_cast<void*>(fn), this, &resolveBinding, true);
+                }
+            }
+#endif
+            return fn;
+        }
+
+        /** Obtaining the export itself, never through a stub */
+        template<class _Func>
+        inline _Func getDirect(const char* name) {
+            ensureLoaded();
+            const uint64_t traceStart = detail::probeStart(SHAREDLIBRARY_PROBE_ENABLED(resolve) || SHAREDLIBRARY_PROBE_ENABLED(resolve__miss));
+            void* p = rawGetSymbol(name);
+            if (!p) {
+                SHAREDLIBRARY_PROBE3(resolve__miss, libPath_.c_str(), name, detail::probeElapsed(traceStart));
+                throwLastError("GetProcAddress", name);
+            }
+            SHAREDLIBRARY_PROBE4(resolve, libPath_.c_str(), name, p, detail::probeElapsed(traceStart));
+            observeResolve(name);
+            return reinterpret_cast<_Func>(p);
+        }
+
+        /** Obtaining without throwing: nullptr when the symbol is absent (load errors still throw) */
+        template<class _Func>
+        inline _Func tryGet(const char* name) {
+            ensureLoaded();
+            const uint64_t traceStart = detail::probeStart(SHAREDLIBRARY_PROBE_ENABLED(resolve) || SHAREDLIBRARY_PROBE_ENABLED(resolve__miss));
+            void* p = rawGetSymbol(name);
+            if (p) {
+                SHAREDLIBRARY_PROBE4(resolve, libPath_.c_str(), name, p, detail::probeElapsed(traceStart));
+                observeResolve(name);
+            } else {
+                SHAREDLIBRARY_PROBE3(resolve__miss, libPath_.c_str(), name, detail::probeElapsed(traceStart));
+            }
+            return reinterpret_cast<_Func>(p);
+        }
+
+#if !defined(_MSC_VER)
+        /** Obtaining a C++ free function by qualified name, e.g. getCpp<int(const char*)>("ns::parse"); mangled at compile time */
+        template<class _Func>
+        inline std::add_pointer_t<std::remove_pointer_t<_Func>> getCpp(const CppSymbol<_Func>& symbol) {
+            return get<std::add_pointer_t<std::remove_pointer_t<_Func>>>(symbol.c_str());
+        }
+#endif
+
+        /** Obtaining through a call-profiling trampoline: counts calls and latency, then forwards */
+        template<class _Func>
+        inline _Func getProfiled(const char* name) {
+#if defined(SHAREDLIBRARY_THUNKS)
+            void* target = reinterpret_cast<void*>(getDirect<_Func>(name));
+            return profiles_.bind<_Func>(libPath_, name, target);
+#else
+            throwLastError("getProfiled", "trampolines are not supported on this platform");
+#endif
+        }
+
+        /** C function pointer of signature _Func calling fn (captures allowed); freed when this library unloads */
+        template<class _Func, class _Fn>
+        inline _Func makeCallback(_Fn&& fn) {
+            return reinterpret_cast<_Func>(closures_.add(detail::makeClosure<_Func>(std::forward<_Fn>(fn))));
+        }
+
+        /** Free a makeCallback() pointer early; the plugin must no longer hold it */
+        inline bool releaseCallback(const void* callback) {
+            return closures_.remove(callback);
+        }
+
+        /** Latency reports of every getProfiled() trampoline */
+        inline std::vector<CallProfile> callProfiles() const {
+            return profiles_.snapshot();
+        }
+
+        /** Bindings made through audit or lazy stubs, with their call counts */
+        inline std::vector<BindingUse> bindingUses() const {
+            return bindings_.snapshot();
+        }
+
+#if defined(SHAREDLIBRARY_ELF)
+        /** Dynamic-linker bindings from/to this library; zeroes unless the process runs under the LD_AUDIT module */
+        inline LibraryBindingStats bindingStats() const;
+#endif
+
+        /** Obtaining by implicitly derivation function type */
+        template<class _Func>
+        inline void get(const char* name, _Func& out){
+            out = get<_Func>(name);
+        }
+
+        /** Obtaining in a batch */
+        template<class... Bindings>
+        inline void batchLoad(Bindings&&... bindings) {
+            const uint64_t traceStart = detail::probeStart(SHAREDLIBRARY_PROBE_ENABLED(batch__load));
+            (batchLoad_one(std::forward<Bindings>(bindings)), ...);
+            SHAREDLIBRARY_PROBE3(batch__load, libPath_.c_str(), sizeof...(Bindings), detail::probeElapsed(traceStart));
+        }
+
+    protected:
+        inline void observeResolve(const char* name) {
+            detail::notifyLoadObserver([this, name](detail::LoadObserver& observer) { observer.onResolve(*this, name); });
+        }
+
+        /** Write the service slot, then run the init export */
+        inline void injectServices() {
+            if (auto slot = static_cast<const ServiceTable**>(rawGetSymbol("sharedlibrary_services"))) {
+                *slot = services_;
+            }
+            using Init = int(*)(const ServiceTable*);
+            if (auto init = reinterpret_cast<Init>(rawGetSymbol("sharedlibrary_init_services"))) {
+                const int rc = init(services_);
+                if (rc != 0) {
+                    unload();
+                    throwLastError("sharedlibrary_init_services", (libPath_ + " returned " + std::to_string(rc)).c_str());
+                }
+            }
+        }
+
+        /** Low-level APIs that derived classes must implement */
+        virtual inline void nativeLoad() = 0;    // Load the library into memory successfully, and set handle_ to non-null.
+        virtual inline void nativeUnload() = 0;  // Offload
+        virtual inline void* rawGetSymbol(const char* name) = 0; // Returns the address of a function or nullptr
+
+        /** Error Handler */
+        [[noreturn]] static inline void throwLastError(const char* api, const char* extra = nullptr){
+            std::string msg = std::string(api) + " failed";
+            if (extra) {
+                msg += " – " + std::string(extra);
+            }
+            throw std::runtime_error(msg);
+        }
+
+    protected:
+        /** Members */
+        std::string libPath_;    // Raw path (UTF-8 / ANSI)
+        bool delayLoad_;         // Whether to delay loading
+        unsigned mode_;          // LoadMode bits
+        std::once_flag flag_;    // Flag used for call_once
+        void* handle_ = nullptr; // Platform handle (HMODULE / void*)
+        std::atomic<uint64_t> generation_{ 0 };    // Loads + unloads so far; read from any thread
+        detail::ProfileTable profiles_;  // getProfiled() trampolines, released with the object
+        detail::ClosureTable closures_;  // makeCallback() thunks, released after the library is closed
+        detail::BindingTable bindings_;  // Audit and lazy binding stubs, released with the object
+        const ServiceTable* services_ = nullptr;   // provideServices() table, injected on every load
+
+    private:
+         /** The internal implementation of batchLoad */
+        template<class _Func>
+        inline void batchLoad_one(const _FuncBinding<_Func>& binding) {
+            _Func* p = binding.ptr;
+            *p = bindAudited<_Func>(binding.name);
+        }
+
+        /** get(), or a stub resolving on first call when the binding plan marks it unused */
+        template<class _Func>
+        inline _Func bindAudited(const char* name) {
+            detail::BindingLedger& ledger = detail::BindingLedger::instance();
+            if (ledger.auditing()) {
+                if constexpr (!detail::ThunkSupported<_Func>::value) {
+                    bindings_.direct(libPath_, name);
+                }
+                return get<_Func>(name);
+            }
+#if defined(SHAREDLIBRARY_THUNKS)
+            if constexpr (detail::ThunkSupported<_Func>::value) {
+                if (ledger.planned(libPath_, name) == 0) {
+                    return bindings_.bind<_Func>(libPath_, name, nullptr, this, &resolveBinding, false);
+                }
+            }
+#endif
+            return get<_Func>(name);
+        }
+
+        static inline void* resolveBinding(void* self, const char* name) {
+            return static_cast<SharedLibraryBase*>(self)->getDirect<void*>(name);
+        }
+    };
+
+    /*--------------------------------------------------------------
+     *  SharedLibrary Windows Implementation
+     *--------------------------------------------------------------*/
+#if defined(_WIN32)
+    // Windows (NT)
+    class SharedLibraryWindows final : public SharedLibraryBase {
+    public:
+        /** Inherited constructor */
+        using SharedLibraryBase::SharedLibraryBase; 
+
+        /** RAII offload */
+        ~SharedLibraryWindows() override {
+            unload();
+        }
+
+        /** Returns to the original HMODULE */
+        void* nativeHandle() const noexcept override {
+            return handle_;
+        }
+
+    protected:
+        /** Native load dll */
+        inline void nativeLoad() override
+        {
+            // Use LoadLibraryExW to allow adding search flags later
+            std::wstring wPath = widenPath(libPath_);
+            // Here we use the most common default flags;
+            // you can also use
+            // LOAD_LIBRARY_SEARCH_APPLICATION_DIR | LOAD_LIBRARY_SEARCH_USER_DIRS
+            HMODULE h = ::LoadLibraryW(wPath.c_str());
+            if (!h) {
+                throwLastError("LoadLibraryW", libPath_.c_str());
+            }
+            handle_ = static_cast<void*>(h);
+        }
+
+        /** Native unload dll */
+        inline void nativeUnload() override
+        {
+            if (handle_){
+                ::FreeLibrary(static_cast<HMODULE>(handle_));
+                handle_ = nullptr;
+            }
+        }
+
+        /** Native get symbol */
+        inline void* rawGetSymbol(const char* name) override {
+            if (!handle_) {
+                return nullptr;
+            }
+            FARPROC p = ::GetProcAddress(static_cast<HMODULE>(handle_), name);
+            return reinterpret_cast<void*>(p);
+        }
+
+    private:
+        // Convert UTF-8/ANSI paths to wide characters
+        static inline std::wstring widenPath(const std::string& s){
+            if (s.empty()) {
+                return L"";
+            }
+            int n = ::MultiByteToWideChar(CP_UTF8, 0, s.data(), (int)s.size(), nullptr, 0);
+            std::wstring w(n, L'\0'); // broadcast
+            ::MultiByteToWideChar(CP_UTF8, 0, s.data(), (int)s.size(), &w[0], n);
+            return w;
+        }
+    };
+#else   
+    // POSIX (Linux / macOS / BSD)
+
+#if defined(SHAREDLIBRARY_ELF)
+    namespace detail {
+
+    /*--------------------------------------------------------------
+     *  ELF image of a loaded object: dynamic section and GOT slots
+     *--------------------------------------------------------------*/
+    class ElfImage {
+    public:
+        /** Build the view from a dlopen handle */
+        explicit ElfImage(void* handle) {
+            struct link_map* lm = nullptr;
+            if (::dlinfo(handle, RTLD_DI_LINKMAP, &lm) != 0 || !lm) {
+                throw std::runtime_error("dlinfo(RTLD_DI_LINKMAP) failed");
+            }
+            base_ = lm->l_addr;
+            dynamic_ = lm->l_ld;
+            for (const ElfW(Dyn)* d = dynamic_; d->d_tag != DT_NULL; ++d) {
+                switch (d->d_tag) {
+                case DT_SYMTAB:   symtab_ = reinterpret_cast<const ElfW(Sym)*>(fixup(d->d_un.d_ptr)); break;
+                case DT_STRTAB:   strtab_ = reinterpret_cast<const char*>(fixup(d->d_un.d_ptr)); break;
+                case DT_RELA:     rela_ = fixup(d->d_un.d_ptr); break;
+                case DT_RELASZ:   relaSize_ = d->d_un.d_val; break;
+                case DT_REL:      rel_ = fixup(d->d_un.d_ptr); break;
+                case DT_RELSZ:    relSize_ = d->d_un.d_val; break;
+                case DT_JMPREL:   jmprel_ = fixup(d->d_un.d_ptr); break;
+                case DT_PLTRELSZ: jmprelSize_ = d->d_un.d_val; break;
+                case DT_PLTREL:   jmprelIsRela_ = d->d_un.d_val == DT_RELA; break;
+                default: break;
+                }
+            }
+            findRelro();
+        }
+
+        /** Load bias of the object */
+        inline uintptr_t base() const noexcept { return base_; }
+
+        /** Visit every GOT slot bound to a named symbol: fn(name, slot) */
+        template<class _Fn>
+        inline void forEachGotSlot(_Fn&& fn) const {
+            walk<ElfW(Rela)>(rela_, relaSize_, fn);
+            walk<ElfW(Rel)>(rel_, relSize_, fn);
+            if (jmprelIsRela_) {
+                walk<ElfW(Rela)>(jmprel_, jmprelSize_, fn);
+            } else {
+                walk<ElfW(Rel)>(jmprel_, jmprelSize_, fn);
+            }
+        }
+
+        /** Overwrite one GOT slot, lifting RELRO protection around the store */
+        inline void writeSlot(void** slot, void* value) const {
+            auto addr = reinterpret_cast<uintptr_t>(slot);
+            if (addr < relroStart_ || addr >= relroEnd_) {
+                __atomic_store_n(slot, value, __ATOMIC_RELEASE);
+                return;
+            }
+            const auto page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+            void* pageStart = reinterpret_cast<void*>(addr & ~(page - 1));
+            if (::mprotect(pageStart, page, PROT_READ | PROT_WRITE) != 0) {
+                throw std::runtime_error("mprotect failed – cannot lift RELRO on GOT");
+            }
+            __atomic_store_n(slot, value, __ATOMIC_RELEASE);
+            ::mprotect(pageStart, page, PROT_READ);
+        }
+
+    private:
+        // glibc relocates d_ptr in place, other loaders leave it as an offset
+        inline uintptr_t fixup(ElfW(Addr) p) const noexcept {
+            return p < base_ ? p + base_ : p;
+        }
+
+        static inline bool isGotRelocation(unsigned type) noexcept {
+#if defined(__x86_64__)
+            return type == R_X86_64_JUMP_SLOT || type == R_X86_64_GLOB_DAT;
+#elif defined(__aarch64__)
+            return type == R_AARCH64_JUMP_SLOT || type == R_AARCH64_GLOB_DAT;
+#elif defined(__i386__)
+            return type == R_386_JMP_SLOT || type == R_386_GLOB_DAT;
+#elif defined(__arm__)
+            return type == R_ARM_JUMP_SLOT || type == R_ARM_GLOB_DAT;
+#else
+            (void)type;
+            return false;
+#endif
+        }
+
+        template<class _Rel, class _Fn>
+        inline void walk(uintptr_t table, size_t size, _Fn& fn) const {
+            if (!table || !symtab_ || !strtab_) {
+                return;
+            }
+            const auto* r = reinterpret_cast<const _Rel*>(table);
+            for (size_t i = 0, n = size / sizeof(_Rel); i < n; ++i) {
+#if __SIZEOF_POINTER__ == 8
+                const auto sym = ELF64_R_SYM(r[i].r_info);
+                const auto type = ELF64_R_TYPE(r[i].r_info);
+#else
+                const auto sym = ELF32_R_SYM(r[i].r_info);
+                const auto type = ELF32_R_TYPE(r[i].r_info);
+#endif
+                if (sym == 0 || !isGotRelocation(static_cast<unsigned>(type))) {
+                    continue;
+                }
+                fn(strtab_ + symtab_[sym].st_name, reinterpret_cast<void**>(base_ + r[i].r_offset));
+            }
+        }
+
+        inline void findRelro() {
+            struct Query { uintptr_t base; const void* dynamic; uintptr_t start, end; } q{ base_, dynamic_, 0, 0 };
+            ::dl_iterate_phdr([](struct dl_phdr_info* info, size_t, void* data) -> int {
+                auto* q = static_cast<Query*>(data);
+                if (info->dlpi_addr != q->base) {
+                    return 0;
+                }
+                bool same = false;
+                uintptr_t start = 0, end = 0;
+                for (unsigned i = 0; i < info->dlpi_phnum; ++i) {
+                    const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+                    if (ph.p_type == PT_DYNAMIC && info->dlpi_addr + ph.p_vaddr == reinterpret_cast<uintptr_t>(q->dynamic)) {
+                        same = true;
+                    } else if (ph.p_type == PT_GNU_RELRO) {
+                        start = info->dlpi_addr + ph.p_vaddr;
+                        end = start + ph.p_memsz;
+                    }
+                }
+                if (!same) {
+                    return 0;
+                }
+                q->start = start;
+                q->end = end;
+                return 1;
+            }, &q);
+            relroStart_ = q.start;
+            relroEnd_ = q.end;
+        }
+
+        uintptr_t base_ = 0;
+        const ElfW(Dyn)* dynamic_ = nullptr;
+        const ElfW(Sym)* symtab_ = nullptr;
+        const char* strtab_ = nullptr;
+        uintptr_t rela_ = 0, rel_ = 0, jmprel_ = 0;
+        size_t relaSize_ = 0, relSize_ = 0, jmprelSize_ = 0;
+        bool jmprelIsRela_ = true;
+        uintptr_t relroStart_ = 0, relroEnd_ = 0;
+    };
+
+    /*--------------------------------------------------------------
+     *  Per-library arena allocator
+     *  One slot of a process-wide address reservation per arena, so
+     *  any pointer maps back to its arena with a range check. Small
+     *  requests come from size-class slabs behind per-thread caches,
+     *  large ones from slab runs. close() drops the whole slot; the
+     *  next arena of the slot starts above it, and every slab header
+     *  carries its arena's generation, so a block freed after its
+     *  arena was released is recognised and ignored.
+     *  libc's internal calls bypass the patched imports: a block the
+     *  plugin allocated must not be grown by libc itself (getline(),
+     *  getdelim(), open_memstream() buffers); glibc would realloc a
+     *  chunk it does not own.
+     *--------------------------------------------------------------*/
+    class AllocArena;
+
+    struct ArenaThreadCache {
+        static constexpr unsigned NumClasses = 40;
+        uint64_t epoch = 0;                 // Arena epoch the lists belong to
+        void* head[NumClasses] = {};        // Intrusive free lists
+        uint32_t count[NumClasses] = {};
+    };
+
+    struct ArenaThreadCaches {
+        static constexpr unsigned MaxArenas = 64;
+        ArenaThreadCache* caches[MaxArenas] = {};
+        inline ~ArenaThreadCaches();        // Returns cached blocks at thread exit
+    };
+
+    inline ArenaThreadCaches& arenaThreadCaches() noexcept {
+        thread_local ArenaThreadCaches caches;
+        return caches;
+    }
+
+    class AllocArena {
+    public:
+        static constexpr size_t   SlabSize   = size_t(256) * 1024;    // Slab granularity and run alignment
+        static constexpr size_t   HeaderSize = 64;                     // Slab header, keeps objects 64-byte aligned
+        static constexpr size_t   MaxSmall   = 32768;                  // Largest request served by size classes
+        static constexpr size_t   Reserve    = size_t(1) << 32;        // Address space per arena
+        static constexpr size_t   CommitStep = size_t(4) << 20;        // mprotect granularity when growing
+        static constexpr unsigned NumClasses = ArenaThreadCache::NumClasses;
+        static constexpr unsigned LargeClass = 0xFFFFu;
+        static constexpr unsigned StatShards = 8;
+        static constexpr uint64_t Magic      = 0x414E455241524C53ull;  // "SLARENA"
+
+        /** Size class of a request (n <= MaxSmall): 16-byte steps to 128, then four per doubling */
+        static inline unsigned classOf(size_t n) noexcept {
+            if (n <= 128) {
+                return n ? static_cast<unsigned>((n + 15) >> 4) - 1 : 0;
+            }
+            const size_t v = n - 1;
+            const unsigned lg = 63u - static_cast<unsigned>(__builtin_clzll(v));
+            return 8 + (lg - 7) * 4 + static_cast<unsigned>((v >> (lg - 2)) & 3);
+        }
+
+        /** Object size of a class */
+        static inline size_t classSize(unsigned c) noexcept {
+            if (c < 8) {
+                return size_t(c + 1) * 16;
+            }
+            const unsigned lg = 7 + (c - 8) / 4;
+            return (size_t(1) << lg) + size_t((c - 8) % 4 + 1) * (size_t(1) << (lg - 2));
+        }
+
+        /** Bind the arena to its slot of the reservation */
+        inline void open(unsigned index, uintptr_t begin) noexcept {
+            std::lock_guard<std::mutex> g(lock_);
+            index_ = index;
+            begin_ = begin;
+            bump_ = low_.load(std::memory_order_relaxed);
+            generation_.fetch_add(1, std::memory_order_relaxed);
+            reserved_ = peakReserved_ = 0;
+            freeRuns_ = nullptr;
+            fallback_.store(0, std::memory_order_relaxed);
+            for (auto& s : stats_) {
+                s.bytes.store(0, std::memory_order_relaxed);
+                s.allocs.store(0, std::memory_order_relaxed);
+                s.frees.store(0, std::memory_order_relaxed);
+            }
+            epoch_.fetch_add(1, std::memory_order_acq_rel);
+            active_.store(true, std::memory_order_release);
+        }
+
+        /** Bulk release: every block is dropped and the slot decommitted */
+        inline AllocationStats close() noexcept {
+            std::lock_guard<std::mutex> g(lock_);
+            AllocationStats last = statsLocked();
+            active_.store(false, std::memory_order_release);
+            epoch_.fetch_add(1, std::memory_order_acq_rel);     // Invalidates every thread cache
+            for (auto& cl : central_) {
+                std::lock_guard<std::mutex> cg(cl.lock);
+                cl.head = nullptr;
+                cl.bump = cl.bumpEnd = nullptr;
+            }
+            const size_t low = low_.load(std::memory_order_relaxed);
+            const size_t committed = committed_.load(std::memory_order_relaxed);
+            if (committed > low) {
+                ::mmap(reinterpret_cast<void*>(begin_ + low), committed - low, PROT_NONE,
+                    MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            }
+            // The next arena of this slot starts above this one: stale pointers stay outside its window.
+            // Wrap once the slot is three-quarters used; past a wrap only the header check (magic and
+            // generation at the slab start) separates stale pointers from live blocks.
+            const size_t next = committed > Reserve / 4 * 3 ? 0 : committed;
+            low_.store(next, std::memory_order_release);
+            committed_.store(next, std::memory_order_release);
+            freeRuns_ = nullptr;
+            bump_ = next;
+            reserved_ = 0;
+            return last;
+        }
+
+        /** Current accounting */
+        inline AllocationStats stats() const noexcept {
+            std::lock_guard<std::mutex> g(lock_);
+            return statsLocked();
+        }
+
+        /** malloc() */
+        inline void* allocate(size_t n) noexcept {
+            if (n <= MaxSmall) {
+                return allocateClass(classOf(n), n);
+            }
+            return allocateLarge(n, HeaderSize);
+        }
+
+        /** memalign() family; align must be a power of two */
+        inline void* allocateAligned(size_t n, size_t align) noexcept {
+            if (align == 0 || (align & (align - 1)) != 0) {
+                return nullptr;
+            }
+            if (align <= 16) {
+                return allocate(n);
+            }
+            if (align <= HeaderSize && n <= MaxSmall) {
+                // Objects sit at HeaderSize + i * size, so a class whose size is a multiple of align is aligned
+                for (unsigned c = classOf(n < align ? align : n); c < NumClasses; ++c) {
+                    if (classSize(c) % align == 0) {
+                        return allocateClass(c, n, align);
+                    }
+                }
+            }
+            if (align >= SlabSize) {
+                return nullptr;
+            }
+            return allocateLarge(n, align < HeaderSize ? HeaderSize : align, align);
+        }
+
+        /** Is p a block of this arena's current generation (not one of a released arena of the slot) */
+        inline bool owns(const void* p) const noexcept {
+            const auto a = reinterpret_cast<uintptr_t>(p);
+            const size_t offset = a - begin_;
+            if (!active_.load(std::memory_order_acquire) || offset < low_.load(std::memory_order_acquire)
+                || offset >= committed_.load(std::memory_order_acquire)) {
+                return false;
+            }
+            const auto* h = reinterpret_cast<const SlabHeader*>(a & ~(SlabSize - 1));
+            return h->magic == Magic && h->generation == generation_.load(std::memory_order_relaxed);
+        }
+
+        /** free() of a block inside this arena's slot */
+        inline void deallocate(void* p) noexcept {
+            if (!owns(p)) {
+                return;     // Stale pointer of a released arena: its memory is already gone
+            }
+            const auto a = reinterpret_cast<uintptr_t>(p);
+            auto* h = reinterpret_cast<SlabHeader*>(a & ~(SlabSize - 1));
+            if (h->sizeClass == LargeClass) {
+                freeLarge(h, a);
+                return;
+            }
+            const unsigned c = h->sizeClass;
+            ArenaThreadCache& tc = cache();
+            *static_cast<void**>(p) = tc.head[c];
+            tc.head[c] = p;
+            account(-static_cast<int64_t>(classSize(c)), 0, 1);
+            if (++tc.count[c] > 2 * batchOf(c)) {
+                drain(tc, c, batchOf(c));
+            }
+        }
+
+        /** malloc_usable_size() of a block inside this arena's slot (0 for a stale one) */
+        inline size_t usableSize(const void* p) const noexcept {
+            if (!owns(p)) {
+                return 0;
+            }
+            const auto a = reinterpret_cast<uintptr_t>(p);
+            const auto* h = reinterpret_cast<const SlabHeader*>(a & ~(SlabSize - 1));
+            if (h->sizeClass == LargeClass) {
+                return h->slabs * SlabSize - (a - reinterpret_cast<uintptr_t>(h));
+            }
+            return classSize(h->sizeClass);
+        }
+
+        /** realloc() of a block inside this arena's slot */
+        inline void* reallocate(void* p, size_t n) noexcept {
+            const size_t have = usableSize(p);
+            if (!have) {
+                errno = ENOMEM;     // Stale block: its contents went with the released arena
+                return nullptr;
+            }
+            if (n <= have && n >= have / 2) {
+                return p;
+            }
+            void* q = allocate(n);
+            if (q) {
+                std::memcpy(q, p, n < have ? n : have);
+                deallocate(p);
+            }
+            return q;
+        }
+
+        /** Return a thread's cached blocks to the central lists */
+        inline void flush(ArenaThreadCache& tc) noexcept {
+            for (unsigned c = 0; c < NumClasses; ++c) {
+                if (tc.count[c]) {
+                    drain(tc, c, tc.count[c]);
+                }
+            }
+        }
+
+        inline uint64_t epoch() const noexcept { return epoch_.load(std::memory_order_acquire); }
+
+    private:
+        struct SlabHeader {
+            uint64_t magic;
+            uint32_t sizeClass;         // LargeClass for large runs
+            uint32_t slabs;             // Run length in slabs
+            SlabHeader* nextFree;       // Chain of free large runs
+            uint64_t generation;        // open() count of the arena that carved it
+        };
+        static_assert(sizeof(SlabHeader) <= HeaderSize, "slab header must fit before the first object");
+
+        struct alignas(64) CentralList {
+            std::mutex lock;
+            void* head = nullptr;       // Returned blocks
+            char* bump = nullptr;       // Untouched remainder of the current slab
+            char* bumpEnd = nullptr;
+        };
+
+        struct alignas(64) StatShard {
+            std::atomic<int64_t> bytes{ 0 };
+            std::atomic<uint64_t> allocs{ 0 };
+            std::atomic<uint64_t> frees{ 0 };
+        };
+
+        static inline size_t batchOf(unsigned c) noexcept {
+            const size_t n = (64 * 1024) / classSize(c);
+            return n < 2 ? 2 : (n > 64 ? 64 : n);
+        }
+
+        inline void account(int64_t bytes, uint64_t allocs, uint64_t frees) noexcept {
+            StatShard& s = stats_[threadIndex() % StatShards];
+            s.bytes.fetch_add(bytes, std::memory_order_relaxed);
+            if (allocs) s.allocs.fetch_add(allocs, std::memory_order_relaxed);
+            if (frees) s.frees.fetch_add(frees, std::memory_order_relaxed);
+        }
+
+        inline AllocationStats statsLocked() const noexcept {
+            AllocationStats st;
+            int64_t bytes = 0;
+            for (const auto& s : stats_) {
+                bytes += s.bytes.load(std::memory_order_relaxed);
+                st.allocations += s.allocs.load(std::memory_order_relaxed);
+                st.frees += s.frees.load(std::memory_order_relaxed);
+            }
+            st.bytesInUse = bytes > 0 ? static_cast<size_t>(bytes) : 0;
+            st.reservedBytes = reserved_;
+            st.peakReservedBytes = peakReserved_;
+            st.fallbackAllocations = fallback_.load(std::memory_order_relaxed);
+            return st;
+        }
+
+        inline ArenaThreadCache& cache() noexcept {
+            ArenaThreadCache*& tc = arenaThreadCaches().caches[index_];
+            const uint64_t e = epoch_.load(std::memory_order_relaxed);
+            if (!tc || tc->epoch != e) {
+                if (!tc) {
+                    tc = new (std::nothrow) ArenaThreadCache();
+                    if (!tc) {
+                        std::abort();
+                    }
+                }
+                *tc = ArenaThreadCache();   // Lists of an older epoch point into released memory
+                tc->epoch = e;
+            }
+            return *tc;
+        }
+
+        inline void* fallback(size_t n, size_t align = 0) noexcept {
+            fallback_.fetch_add(1, std::memory_order_relaxed);
+            if (align > 16) {
+                void* p = nullptr;
+                return ::posix_memalign(&p, align, n) == 0 ? p : nullptr;
+            }
+            return ::malloc(n);
+        }
+
+        /** align: what the caller asked for, kept when the arena is exhausted and malloc takes over */
+        inline void* allocateClass(unsigned c, size_t n, size_t align = 0) noexcept {
+            ArenaThreadCache& tc = cache();
+            void* p = tc.head[c];
+            if (p) {
+                tc.head[c] = *static_cast<void**>(p);
+                --tc.count[c];
+            } else if (!(p = refill(tc, c))) {
+                return fallback(n, align);
+            }
+            account(static_cast<int64_t>(classSize(c)), 1, 0);
+            return p;
+        }
+
+        inline void* refill(ArenaThreadCache& tc, unsigned c) noexcept {
+            CentralList& cl = central_[c];
+            const size_t size = classSize(c), want = batchOf(c);
+            void* first = nullptr;
+            std::lock_guard<std::mutex> g(cl.lock);
+            for (size_t got = 0; got < want; ++got) {
+                void* p = cl.head;
+                if (p) {
+                    cl.head = *static_cast<void**>(p);
+                } else {
+                    if (cl.bump == cl.bumpEnd && !newSlab(cl, c)) {
+                        break;
+                    }
+                    p = cl.bump;
+                    cl.bump += size;
+                }
+                if (!first) {
+                    first = p;
+                } else {
+                    *static_cast<void**>(p) = tc.head[c];
+                    tc.head[c] = p;
+                    ++tc.count[c];
+                }
+            }
+            return first;
+        }
+
+        inline void drain(ArenaThreadCache& tc, unsigned c, size_t n) noexcept {
+            CentralList& cl = central_[c];
+            std::lock_guard<std::mutex> g(cl.lock);
+            if (tc.epoch != epoch_.load(std::memory_order_acquire)) {
+                return;     // Arena closed underneath a cache that is being flushed
+            }
+            while (n-- && tc.head[c]) {
+                void* p = tc.head[c];
+                tc.head[c] = *static_cast<void**>(p);
+                --tc.count[c];
+                *static_cast<void**>(p) = cl.head;
+                cl.head = p;
+            }
+        }
+
+        inline bool newSlab(CentralList& cl, unsigned c) noexcept {
+            SlabHeader* h = nullptr;
+            {
+                std::lock_guard<std::mutex> g(lock_);
+                h = allocRun(1);
+            }
+            if (!h) {
+                return false;
+            }
+            h->sizeClass = c;
+            const size_t size = classSize(c);
+            cl.bump = reinterpret_cast<char*>(h) + HeaderSize;
+            cl.bumpEnd = cl.bump + ((SlabSize - HeaderSize) / size) * size;
+            return true;
+        }
+
+        inline void* allocateLarge(size_t n, size_t offset, size_t align = 0) noexcept {
+            if (n > Reserve / 2) {
+                return fallback(n, align);
+            }
+            const size_t slabs = (n + offset + SlabSize - 1) / SlabSize;
+            SlabHeader* h = nullptr;
+            {
+                std::lock_guard<std::mutex> g(lock_);
+                h = allocRun(slabs);
+            }
+            if (!h) {
+                return fallback(n, align);
+            }
+            h->sizeClass = LargeClass;
+            account(static_cast<int64_t>(slabs * SlabSize - offset), 1, 0);
+            return reinterpret_cast<char*>(h) + offset;
+        }
+
+        inline void freeLarge(SlabHeader* h, uintptr_t p) noexcept {
+            const size_t slabs = h->slabs;
+            account(-static_cast<int64_t>(slabs * SlabSize - (p - reinterpret_cast<uintptr_t>(h))), 0, 1);
+            ::madvise(h, slabs * SlabSize, MADV_DONTNEED);
+            std::lock_guard<std::mutex> g(lock_);
+            h->magic = Magic;
+            h->sizeClass = LargeClass;
+            h->slabs = static_cast<uint32_t>(slabs);
+            h->generation = generation_.load(std::memory_order_relaxed);
+            h->nextFree = freeRuns_;
+            freeRuns_ = h;
+            reserved_ -= slabs * SlabSize;
+        }
+
+        // Caller holds lock_
+        inline SlabHeader* allocRun(size_t slabs) noexcept {
+            SlabHeader** best = nullptr;
+            for (SlabHeader** it = &freeRuns_; *it; it = &(*it)->nextFree) {
+                if ((*it)->slabs >= slabs && (!best || (*it)->slabs < (*best)->slabs)) {
+                    best = it;
+                }
+            }
+            SlabHeader* run = nullptr;
+            if (best) {
+                run = *best;
+                *best = run->nextFree;
+                if (run->slabs > slabs) {
+                    auto* rest = reinterpret_cast<SlabHeader*>(reinterpret_cast<char*>(run) + slabs * SlabSize);
+                    rest->magic = Magic;
+                    rest->sizeClass = LargeClass;
+                    rest->slabs = static_cast<uint32_t>(run->slabs - slabs);
+                    rest->generation = generation_.load(std::memory_order_relaxed);
+                    rest->nextFree = freeRuns_;
+                    freeRuns_ = rest;
+                }
+            } else {
+                const size_t bytes = slabs * SlabSize;
+                if (bytes > Reserve - bump_) {
+                    return nullptr;
+                }
+                const size_t committed = committed_.load(std::memory_order_relaxed);
+                if (bump_ + bytes > committed) {
+                    size_t target = (bump_ + bytes + CommitStep - 1) / CommitStep * CommitStep;
+                    target = target > Reserve ? Reserve : target;
+                    if (::mprotect(reinterpret_cast<void*>(begin_ + committed), target - committed, PROT_READ | PROT_WRITE) != 0) {
+                        return nullptr;
+                    }
+                    committed_.store(target, std::memory_order_release);
+                }
+                run = reinterpret_cast<SlabHeader*>(begin_ + bump_);
+                bump_ += bytes;
+            }
+            run->magic = Magic;
+            run->slabs = static_cast<uint32_t>(slabs);
+            run->generation = generation_.load(std::memory_order_relaxed);
+            run->nextFree = nullptr;
+            reserved_ += slabs * SlabSize;
+            peakReserved_ = reserved_ > peakReserved_ ? reserved_ : peakReserved_;
+            return run;
+        }
+
+        /** Members */
+        unsigned index_ = 0;                    // Slot in ArenaSpace
+        uintptr_t begin_ = 0;                   // Start of the slot
+        std::atomic<size_t> low_{ 0 };          // Start of this generation's window, offset from begin_
+        std::atomic<size_t> committed_{ 0 };    // End of the read/write window, offset from begin_
+        std::atomic<uint64_t> generation_{ 0 }; // open() count, stamped into slab headers
+        std::atomic<uint64_t> epoch_{ 0 };      // Bumped on open/close, stale thread caches reset
+        std::atomic<bool> active_{ false };
+        std::atomic<uint64_t> fallback_{ 0 };
+        mutable std::mutex lock_;               // Guards runs and the counters below
+        size_t bump_ = 0;
+        size_t reserved_ = 0, peakReserved_ = 0;
+        SlabHeader* freeRuns_ = nullptr;
+        CentralList central_[NumClasses];
+        StatShard stats_[StatShards];
+    };
+
+    /*--------------------------------------------------------------
+     *  Process-wide arena slots sharing one address reservation
+     *--------------------------------------------------------------*/
+    struct ArenaSpace {
+        static constexpr unsigned MaxArenas = ArenaThreadCaches::MaxArenas;
+        static constexpr size_t Span = size_t(MaxArenas) * AllocArena::Reserve;
+
+        static inline std::atomic<uintptr_t> base{ 0 };
+        static inline std::mutex lock;
+        static inline AllocArena arenas[MaxArenas];
+        static inline void* owners[MaxArenas] = {};     // dlopen handle per slot
+        static inline unsigned refs[MaxArenas] = {};
+
+        /** Slot of an arena-owned pointer, or -1 */
+        static inline int slotOf(const void* p) noexcept {
+            const uintptr_t b = base.load(std::memory_order_acquire);
+            const auto a = reinterpret_cast<uintptr_t>(p);
+            return (b && a - b < Span) ? static_cast<int>((a - b) / AllocArena::Reserve) : -1;
+        }
+
+        /** Arena slot for a library handle (shared when the same object is attached twice), -1 when full */
+        static inline int acquire(void* handle) {
+            std::lock_guard<std::mutex> g(lock);
+            if (!base.load(std::memory_order_relaxed)) {
+                // Slab headers are found by masking, so the reservation must be SlabSize-aligned
+                void* p = ::mmap(nullptr, Span + AllocArena::SlabSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if (p == MAP_FAILED) {
+                    throw std::runtime_error("mmap failed – cannot reserve arena address space");
+                }
+                const auto raw = reinterpret_cast<uintptr_t>(p);
+                const uintptr_t aligned = (raw + AllocArena::SlabSize - 1) & ~(uintptr_t(AllocArena::SlabSize) - 1);
+                if (aligned > raw) {
+                    ::munmap(p, aligned - raw);
+                }
+                if (raw + AllocArena::SlabSize > aligned) {
+                    ::munmap(reinterpret_cast<void*>(aligned + Span), raw + AllocArena::SlabSize - aligned);
+                }
+                base.store(aligned, std::memory_order_release);
+            }
+            int freeSlot = -1;
+            for (unsigned i = 0; i < MaxArenas; ++i) {
+                if (refs[i] && owners[i] == handle) {
+                    ++refs[i];
+                    return static_cast<int>(i);
+                }
+                if (!refs[i] && freeSlot < 0) {
+                    freeSlot = static_cast<int>(i);
+                }
+            }
+            if (freeSlot >= 0) {
+                arenas[freeSlot].open(static_cast<unsigned>(freeSlot), base.load(std::memory_order_relaxed) + freeSlot * AllocArena::Reserve);
+                owners[freeSlot] = handle;
+                refs[freeSlot] = 1;
+            }
+            return freeSlot;
+        }
+
+        /** Drop a reference; the last one bulk-releases the arena unless the code is still mapped */
+        static inline AllocationStats release(int slot, bool stillMapped) noexcept {
+            std::lock_guard<std::mutex> g(lock);
+            if (refs[slot] > 1 || stillMapped) {
+                refs[slot] -= refs[slot] > 1 ? 1 : 0;
+                return arenas[slot].stats();
+            }
+            refs[slot] = 0;
+            owners[slot] = nullptr;
+            return arenas[slot].close();
+        }
+
+        static inline void free(void* p) noexcept {
+            const int s = slotOf(p);
+            if (s < 0) {
+                ::free(p);
+            } else {
+                arenas[s].deallocate(p);
+            }
+        }
+
+        static inline void* reallocate(AllocArena& arena, void* p, size_t n) noexcept {
+            if (!p) {
+                return arena.allocate(n);
+            }
+            const int s = slotOf(p);
+            if (s < 0) {
+                return ::realloc(p, n);     // Allocated before interposition or by the host
+            }
+            if (n == 0) {
+                arenas[s].deallocate(p);
+                return nullptr;
+            }
+            return arenas[s].reallocate(p, n);
+        }
+
+        static inline size_t usableSize(void* p) noexcept {
+            const int s = slotOf(p);
+            return s < 0 ? ::malloc_usable_size(p) : arenas[s].usableSize(p);
+        }
+    };
+
+    inline ArenaThreadCaches::~ArenaThreadCaches() {
+        for (unsigned i = 0; i < MaxArenas; ++i) {
+            if (caches[i]) {
+                ArenaSpace::arenas[i].flush(*caches[i]);
+                delete caches[i];
+            }
+        }
+    }
+
+    /*--------------------------------------------------------------
+     *  Interposition targets of one arena slot
+     *--------------------------------------------------------------*/
+    template<unsigned _Slot>
+    struct ArenaHooks {
+        static inline AllocArena& arena() noexcept { return ArenaSpace::arenas[_Slot]; }
+
+        static void* mallocHook(size_t n) noexcept { return failed(arena().allocate(n)); }
+        static void freeHook(void* p) noexcept { ArenaSpace::free(p); }
+        static void* reallocHook(void* p, size_t n) noexcept {
+            void* q = ArenaSpace::reallocate(arena(), p, n);
+            return n ? failed(q) : q;
+        }
+        static size_t usableSizeHook(void* p) noexcept { return p ? ArenaSpace::usableSize(p) : 0; }
+
+        static void* callocHook(size_t n, size_t m) noexcept {
+            if (m && n > SIZE_MAX / m) {
+                errno = ENOMEM;
+                return nullptr;
+            }
+            void* p = arena().allocate(n * m);
+            if (p) {
+                std::memset(p, 0, n * m);
+            }
+            return failed(p);
+        }
+
+        static int posixMemalignHook(void** out, size_t align, size_t n) noexcept {
+            if (align % sizeof(void*) != 0 || (align & (align - 1)) != 0) {
+                return EINVAL;
+            }
+            void* p = arena().allocateAligned(n, align);
+            if (!p) {
+                return ENOMEM;
+            }
+            *out = p;
+            return 0;
+        }
+
+        static void* memalignHook(size_t align, size_t n) noexcept {
+            if (align == 0 || (align & (align - 1)) != 0) {
+                errno = EINVAL;
+                return nullptr;
+            }
+            return failed(arena().allocateAligned(n, align));
+        }
+        static void* vallocHook(size_t n) noexcept { return failed(arena().allocateAligned(n, static_cast<size_t>(::sysconf(_SC_PAGESIZE)))); }
+
+        // operator new: the align_val_t / nothrow_t arguments arrive in registers and are read or ignored as plain words
+        static void* newHook(size_t n) {
+            void* p = arena().allocate(n);
+            if (!p) {
+                throw std::bad_alloc();
+            }
+            return p;
+        }
+        static void* newNothrowHook(size_t n) noexcept { return arena().allocate(n); }
+        static void* newAlignedHook(size_t n, size_t align) {
+            void* p = arena().allocateAligned(n, align);
+            if (!p) {
+                throw std::bad_alloc();
+            }
+            return p;
+        }
+        static void* newAlignedNothrowHook(size_t n, size_t align) noexcept { return arena().allocateAligned(n, align); }
+
+        /** The C allocation functions report exhaustion through errno */
+        static inline void* failed(void* p) noexcept {
+            if (!p) {
+                errno = ENOMEM;
+            }
+            return p;
+        }
+    };
+
+    struct ArenaSymbol {
+        const char* name;
+        void* fn;
+    };
+
+#if __SIZEOF_SIZE_T__ == 8
+#define SHAREDLIBRARY_MSIZE "m"
+#else
+#define SHAREDLIBRARY_MSIZE "j"
+#endif
+    template<unsigned _Slot>
+    inline const ArenaSymbol* arenaSymbols() noexcept {
+        using H = ArenaHooks<_Slot>;
+        static const ArenaSymbol table[] = {
+            { "malloc",              reinterpret_cast<void*>(&H::mallocHook) },
+            { "free",                reinterpret_cast<void*>(&H::freeHook) },
+            { "cfree",               reinterpret_cast<void*>(&H::freeHook) },
+            { "calloc",              reinterpret_cast<void*>(&H::callocHook) },
+            { "realloc",             reinterpret_cast<void*>(&H::reallocHook) },
+            { "posix_memalign",      reinterpret_cast<void*>(&H::posixMemalignHook) },
+            { "aligned_alloc",       reinterpret_cast<void*>(&H::memalignHook) },
+            { "memalign",            reinterpret_cast<void*>(&H::memalignHook) },
+            { "valloc",              reinterpret_cast<void*>(&H::vallocHook) },
+            { "malloc_usable_size",  reinterpret_cast<void*>(&H::usableSizeHook) },
+            { "_Znw" SHAREDLIBRARY_MSIZE,                                   reinterpret_cast<void*>(&H::newHook) },
+            { "_Zna" SHAREDLIBRARY_MSIZE,                                   reinterpret_cast<void*>(&H::newHook) },
+            { "_Znw" SHAREDLIBRARY_MSIZE "RKSt9nothrow_t",                  reinterpret_cast<void*>(&H::newNothrowHook) },
+            { "_Zna" SHAREDLIBRARY_MSIZE "RKSt9nothrow_t",                  reinterpret_cast<void*>(&H::newNothrowHook) },
+            { "_Znw" SHAREDLIBRARY_MSIZE "St11align_val_t",                 reinterpret_cast<void*>(&H::newAlignedHook) },
+            { "_Zna" SHAREDLIBRARY_MSIZE "St11align_val_t",                 reinterpret_cast<void*>(&H::newAlignedHook) },
+            { "_Znw" SHAREDLIBRARY_MSIZE "St11align_val_tRKSt9nothrow_t",   reinterpret_cast<void*>(&H::newAlignedNothrowHook) },
+            { "_Zna" SHAREDLIBRARY_MSIZE "St11align_val_tRKSt9nothrow_t",   reinterpret_cast<void*>(&H::newAlignedNothrowHook) },
+            { "_ZdlPv",                                                     reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdaPv",                                                     reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdlPv" SHAREDLIBRARY_MSIZE,                                 reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdaPv" SHAREDLIBRARY_MSIZE,                                 reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdlPvRKSt9nothrow_t",                                       reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdaPvRKSt9nothrow_t",                                       reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdlPvSt11align_val_t",                                      reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdaPvSt11align_val_t",                                      reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdlPv" SHAREDLIBRARY_MSIZE "St11align_val_t",               reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdaPv" SHAREDLIBRARY_MSIZE "St11align_val_t",               reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdlPvSt11align_val_tRKSt9nothrow_t",                        reinterpret_cast<void*>(&H::freeHook) },
+            { "_ZdaPvSt11align_val_tRKSt9nothrow_t",                        reinterpret_cast<void*>(&H::freeHook) },
+            { nullptr, nullptr }
+        };
+        return table;
+    }
+#undef SHAREDLIBRARY_MSIZE
+
+    template<size_t... _Slots>
+    inline const ArenaSymbol* arenaSymbolsFor(unsigned slot, std::index_sequence<_Slots...>) noexcept {
+        static const ArenaSymbol* const tables[] = { arenaSymbols<static_cast<unsigned>(_Slots)>()... };
+        return tables[slot];
+    }
+
+    /** Point the allocation imports of a loaded object at an arena slot */
+    inline void interposeArena(void* handle, unsigned slot) {
+        const ArenaSymbol* table = arenaSymbolsFor(slot, std::make_index_sequence<ArenaSpace::MaxArenas>{});
+        ElfImage image(handle);
+        image.forEachGotSlot([&](const char* name, void** got) {
+            for (const ArenaSymbol* s = table; s->name; ++s) {
+                if (std::strcmp(name, s->name) == 0) {
+                    image.writeSlot(got, s->fn);
+                    break;
+                }
+            }
+        });
+    }
+
+    }   // namespace detail
+#endif  // SHAREDLIBRARY_ELF
+
+    namespace detail {
+
+    /*--------------------------------------------------------------
+     *  Deferred unload (LoadDeferredUnload)
+     *  dlclose, with its destructors, munmaps and loader lock, runs
+     *  on a niced background thread. Queued handles are closed in
+     *  batches, newest load first, so dependants go before their
+     *  dependencies.
+     *--------------------------------------------------------------*/
+    class UnloadReaper {
+    public:
+        struct Item {
+            void* handle = nullptr;
+            uint64_t sequence = 0;              // Load order
+            std::function<void()> after;        // Cleanup that must follow dlclose
+        };
+
+        static inline UnloadReaper& instance() {
+            static UnloadReaper* reaper = new UnloadReaper();  // Leaked: never joined during exit
+            return *reaper;
+        }
+
+        static inline uint64_t nextSequence() noexcept {
+            static std::atomic<uint64_t> sequence{ 0 };
+            return sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        inline void push(Item item) {
+            {
+                std::lock_guard<std::mutex> g(lock_);
+                queue_.push_back(std::move(item));
+                if (!started_) {
+                    started_ = true;
+                    std::thread([this] { run(); }).detach();
+                }
+            }
+            wake_.notify_one();
+        }
+
+        /** Close everything queued so far on the calling thread, and wait for the reaper's batch */
+        inline void drain() {
+            std::unique_lock<std::mutex> lk(lock_);
+            for (;;) {
+                if (!queue_.empty()) {
+                    std::vector<Item> batch;
+                    batch.swap(queue_);
+                    ++inFlight_;
+                    lk.unlock();
+                    reap(batch);
+                    lk.lock();
+                    --inFlight_;
+                    idle_.notify_all();
+                } else if (inFlight_) {
+                    idle_.wait(lk);
+                } else {
+                    return;
+                }
+            }
+        }
+
+        inline size_t pending() {
+            std::lock_guard<std::mutex> g(lock_);
+            return queue_.size() + inFlight_;
+        }
+
+    private:
+        static constexpr size_t kBatch = 64;
+        static constexpr auto kLinger = std::chrono::milliseconds(20);     // Gather a batch before closing
+
+        inline void run() {
+#if defined(__linux__)
+            ::setpriority(PRIO_PROCESS, 0, 19);     // Per-thread on Linux; not SCHED_IDLE, which could starve the loader lock
+#endif
+            std::unique_lock<std::mutex> lk(lock_);
+            for (;;) {
+                wake_.wait(lk, [this] { return !queue_.empty(); });
+                wake_.wait_for(lk, kLinger, [this] { return queue_.size() >= kBatch; });
+                if (queue_.empty()) {
+                    continue;       // drain() took it
+                }
+                std::vector<Item> batch;
+                batch.swap(queue_);
+                ++inFlight_;
+                lk.unlock();
+                reap(batch);
+                lk.lock();
+                --inFlight_;
+                idle_.notify_all();
+            }
+        }
+
+        static inline void reap(std::vector<Item>& batch) {
+            std::sort(batch.begin(), batch.end(), [](const Item& a, const Item& b) { return a.sequence > b.sequence; });
+            for (Item& item : batch) {
+                ::dlclose(item.handle);
+                if (item.after) {
+                    item.after();
+                }
+            }
+        }
+
+        std::mutex lock_;
+        std::condition_variable wake_;
+        std::condition_variable idle_;
+        std::vector<Item> queue_;
+        size_t inFlight_ = 0;       // Batches being closed outside the lock
+        bool started_ = false;
+    };
+
+    }   // namespace detail
+
+    /** Run every deferred dlclose now and wait for them (tests, orderly shutdown) */
+    inline void drainUnloads() {
+        detail::UnloadReaper::instance().drain();
+    }
+
+    /** Deferred dlcloses not yet finished */
+    inline size_t pendingUnloads() {
+        return detail::UnloadReaper::instance().pending();
+    }
+
+    /*--------------------------------------------------------------
+     *  SharedLibrary POSIX Implementation
+     *--------------------------------------------------------------*/
+    class SharedLibraryPosix final : public SharedLibraryBase {
+    public:
+        using SharedLibraryBase::SharedLibraryBase;
+
+        /** Load from an already opened (and verified) file; takes ownership of fd */
+        SharedLibraryPosix(std::string_view path, int fd, bool delayLoad, unsigned mode)
+            : SharedLibraryBase(path, delayLoad, mode), fd_(fd) {}
+
+        /** RAII offload */
+        ~SharedLibraryPosix() override {
+            unload();
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+        }
+
+        /** Returns POSIX Native Handle */
+        void* nativeHandle() const noexcept override {
+            return handle_;
+        }
+
+        /** Allocation accounting of the private arena (LoadArenaAllocator) */
+        inline AllocationStats allocationStats() const noexcept override {
+#if defined(SHAREDLIBRARY_ELF)
+            if (arenaSlot_ >= 0) {
+                return detail::ArenaSpace::arenas[arenaSlot_].stats();
+            }
+#endif
+            return arenaStats_;
+        }
+
+    protected:
+        /** Native load so */
+        inline void nativeLoad() override
+        {
+            // RTLD_NOW: Resolve Immediately 
+            // RTLD_LAZY: Want delayed resolution
+            // RTLD_LOCAL: Exported to the global table
+            void* h = ::dlopen(loadPath().c_str(), ((mode_ & LoadBindNow) ? RTLD_NOW : RTLD_LAZY) | RTLD_LOCAL);
+            if (!h) {
+                throw std::runtime_error(std::string("dlopen failed: ") + dlerror());
+            }
+            handle_ = h;
+            sequence_ = detail::UnloadReaper::nextSequence();
+#if defined(SHAREDLIBRARY_ELF)
+            if (mode_ & LoadArenaAllocator) {
+                attachArena();
+            }
+#endif
+        }
+
+        /** Native unload so */
+        inline void nativeUnload() override {
+            if (handle_){
+                if (mode_ & LoadDeferredUnload) {
+                    deferUnload();
+                } else {
+                    ::dlclose(handle_);
+#if defined(SHAREDLIBRARY_ELF)
+                    detachArena();
+#endif
+                }
+                handle_ = nullptr;
+            }
+        }
+
+        /** Native get symbol */
+        inline void* rawGetSymbol(const char* name) override
+        {
+            if (!handle_) return nullptr;
+            // Clear lasr error
+            ::dlerror();
+            void* p = ::dlsym(handle_, name);
+            const char* err = ::dlerror();
+            if (err) {
+                return nullptr;
+            }
+            return p;
+        }
+
+    private:
+        /** Hand the handle, and what must be released after it, to the reaper */
+        inline void deferUnload() {
+            detail::UnloadReaper::Item item;
+            item.handle = handle_;
+            item.sequence = sequence_;
+            const int fd = fd_;
+            auto closures = closures_.detach();     // Destructors run by dlclose may still call back
+#if defined(SHAREDLIBRARY_ELF)
+            const int slot = arenaSlot_;
+            item.after = [slot, fd, closures, path = loadPath()] {
+                if (slot >= 0) {
+                    releaseArena(slot, path);
+                }
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                closures->clear();
+            };
+            arenaSlot_ = -1;
+#else
+            item.after = [fd, closures] {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                closures->clear();
+            };
+#endif
+            fd_ = -1;
+            detail::UnloadReaper::instance().push(std::move(item));
+        }
+
+        /** Path handed to dlopen: the verified descriptor when there is one */
+        inline std::string loadPath() const {
+            return fd_ >= 0 ? "/proc/self/fd/" + std::to_string(fd_) : libPath_;
+        }
+
+#if defined(SHAREDLIBRARY_ELF)
+        /** Give the freshly loaded object its own arena */
+        inline void attachArena() {
+            if (sizeof(void*) != 8) {
+                nativeUnload();
+                throw std::runtime_error("LoadArenaAllocator requires a 64-bit address space");
+            }
+            const int slot = detail::ArenaSpace::acquire(handle_);
+            if (slot < 0) {
+                nativeUnload();
+                throw std::runtime_error("LoadArenaAllocator failed – all arena slots in use: " + libPath_);
+            }
+            arenaSlot_ = slot;
+            try {
+                detail::interposeArena(handle_, static_cast<unsigned>(slot));
+            } catch (...) {
+                nativeUnload();
+                throw;
+            }
+        }
+
+        /** Bulk release once the object is really gone */
+        inline void detachArena() noexcept {
+            if (arenaSlot_ < 0) {
+                return;
+            }
+            arenaStats_ = releaseArena(arenaSlot_, loadPath());
+            arenaSlot_ = -1;
+        }
+
+        static inline AllocationStats releaseArena(int slot, const std::string& path) noexcept {
+            // Another dlopen reference keeps the code alive, and with it the patched GOT
+            void* still = ::dlopen(path.c_str(), RTLD_LAZY | RTLD_NOLOAD);
+            if (still) {
+                ::dlclose(still);
+            }
+            return detail::ArenaSpace::release(slot, still != nullptr);
+        }
+
+        int arenaSlot_ = -1;             // Slot in detail::ArenaSpace, -1 when not attached
+#endif
+        AllocationStats arenaStats_;     // Final accounting after unload
+        int fd_ = -1;                    // Verified file the object is loaded from, -1 for libPath_
+        uint64_t sequence_ = 0;          // Load order, for reverse-order deferred unloads
+    };
+
+#endif   // _WIN32 / POSIX
+
+    /*--------------------------------------------------------------
+     *  SharedLibrary Factory Wrapper
+     *--------------------------------------------------------------*/
+    inline std::unique_ptr<SharedLibraryBase> makeSharedLibrary(const std::string& path, bool delayLoad = false, unsigned mode = LoadDefault) {
+#if defined(_WIN32)
+        // Windows
+        return std::make_unique<SharedLibraryWindows>(path, delayLoad, mode);
+#else
+        return std::make_unique<SharedLibraryPosix>(path, delayLoad, mode);
+#endif
+    }
+
+    /*--------------------------------------------------------------
+     *  Fast process exit
+     *--------------------------------------------------------------*/
+
+    /** Finalize safe libraries, dlclose the rest newest first, then _Exit without static destructors */
+    [[noreturn]] inline void fastExit(int code) {
+        setShutdownPolicy(ShutdownPolicy::Fast);
+        detail::exiting().store(true);
+        auto live = detail::LibraryRegistry::instance().snapshot();
+        std::sort(live.begin(), live.end(), [](const auto& a, const auto& b) { return a.sequence > b.sequence; });
+        for (const auto& entry : live) {
+            // Owners are left in place; exiting makes the const_cast moot
+            const_cast<SharedLibraryBase*>(entry.owner)->unload();
+        }
+#if !defined(_WIN32)
+        drainUnloads();
+#endif
+        std::fflush(nullptr);
+        std::_Exit(code);
+    }
+
+    /*--------------------------------------------------------------
+     *  Binding audit
+     *  Audit run: get() and batchLoad() bind through counting stubs
+     *  that also note the order of first calls; the report lists per
+     *  library which bindings were called, and the same data yields
+     *  linker ordering files. Later runs load the report as a plan:
+     *  bindings it marks unused are not looked up at startup but on
+     *  first call, through a stub.
+     *--------------------------------------------------------------*/
+
+    /** Route subsequent get()/batchLoad() bindings through counting stubs */
+    inline void auditBindings(bool on) noexcept {
+        detail::BindingLedger::instance().setAuditing(on);
+    }
+
+    /** Write every audited binding: "used|unused|unknown <TAB> library <TAB> symbol <TAB> calls <TAB> first-call order" */
+    inline void writeBindingReport(const std::string& path) {
+        const auto libraries = detail::BindingLedger::instance().collect();
+        FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) {
+            throw std::runtime_error("writeBindingReport failed – " + path);
+        }
+        std::fprintf(f, "# sharedlibrary binding report v1\n");
+        for (const auto& lib : libraries) {
+            size_t unused = 0;
+            for (const auto& use : lib.second) {
+                unused += use.second.counted && use.second.calls == 0;
+            }
+            std::fprintf(f, "# %s: %zu bound, %zu unused\n", lib.first.c_str(), lib.second.size(), unused);
+            for (const auto& use : lib.second) {
+                const BindingUse& u = use.second;
+                if (u.counted) {
+                    std::fprintf(f, "%s\t%s\t%s\t%llu\t%llu\n", u.calls ? "used" : "unused", lib.first.c_str(),
+                        u.symbol.c_str(), static_cast<unsigned long long>(u.calls), static_cast<unsigned long long>(u.firstCall));
+                } else {
+                    std::fprintf(f, "unknown\t%s\t%s\t-\t-\n", lib.first.c_str(), u.symbol.c_str());
+                }
+            }
+        }
+        std::fclose(f);
+    }
+
+    /** Load a report as the binding plan: its unused bindings resolve on first call instead of in batchLoad() */
+    inline void loadBindingPlan(const std::string& path) {
+        FILE* f = std::fopen(path.c_str(), "r");
+        if (!f) {
+            throw std::runtime_error("loadBindingPlan failed – " + path);
+        }
+        std::map<std::string, std::map<std::string, bool>> plan;
+        char line[4096];
+        while (std::fgets(line, sizeof(line), f)) {
+            std::string l(line);
+            while (!l.empty() && (l.back() == '\n' || l.back() == '\r')) {
+                l.pop_back();
+            }
+            const size_t a = l.find('\t');
+            const size_t b = a == std::string::npos ? a : l.find('\t', a + 1);
+            if (l.empty() || l[0] == '#' || b == std::string::npos) {
+                continue;
+            }
+            const size_t c = l.find('\t', b + 1);
+            plan[l.substr(a + 1, b - a - 1)][l.substr(b + 1, c == std::string::npos ? c : c - b - 1)] = l.compare(0, a, "unused") != 0;
+        }
+        std::fclose(f);
+        detail::BindingLedger::instance().setPlan(std::move(plan));
+    }
+
+    /** Forget the plan: batchLoad() resolves everything again */
+    inline void clearBindingPlan() {
+        detail::BindingLedger::instance().setPlan({});
+    }
+
+    enum class SymbolOrder {
+        FirstCall,      // Startup locality: functions in the order they were first called
+        Frequency,      // Steady-state locality: most called first
+    };
+
+    enum class OrderingFormat {
+        Symbols,        // One symbol per line: lld --symbol-ordering-file
+        Sections,       // .text.<symbol> per line: gold --section-ordering-file (build with -ffunction-sections)
+    };
+
+    /** Linker ordering input for one audited library (path as loaded, or its file name); returns lines written */
+    inline size_t writeSymbolOrdering(const std::string& path, const std::string& library,
+                                      SymbolOrder order = SymbolOrder::FirstCall, OrderingFormat format = OrderingFormat::Symbols) {
+        const auto libraries = detail::BindingLedger::instance().collect();
+        std::vector<BindingUse> called;
+        for (const auto& lib : libraries) {
+            const size_t slash = lib.first.find_last_of('/');
+            if (lib.first != library && lib.first.compare(slash == std::string::npos ? 0 : slash + 1, std::string::npos, library) != 0) {
+                continue;
+            }
+            for (const auto& use : lib.second) {
+                if (use.second.calls) {
+                    called.push_back(use.second);
+                }
+            }
+        }
+        std::sort(called.begin(), called.end(), [order](const BindingUse& a, const BindingUse& b) {
+            if (order == SymbolOrder::Frequency && a.calls != b.calls) {
+                return a.calls > b.calls;
+            }
+            return a.firstCall < b.firstCall;
+        });
+        FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) {
+            throw std::runtime_error("writeSymbolOrdering failed – " + path);
+        }
+        std::set<std::string> written;     // An export bound under two signatures appears once
+        for (const BindingUse& use : called) {
+            if (written.insert(use.symbol).second) {
+                std::fprintf(f, "%s%s\n", format == OrderingFormat::Sections ? ".text." : "", use.symbol.c_str());
+            }
+        }
+        std::fclose(f);
+        return written.size();
+    }
+
+    /*--------------------------------------------------------------
+     *  SharedLibrary Bind Helper
+     *--------------------------------------------------------------*/
+    template<class _Func>
+    _FuncBinding<_Func> bind(const char* name, _Func& out) {
+        return { name, &out };
+    }
+
+    /*--------------------------------------------------------------
+     *  Ordered search scope over several libraries
+     *  A name resolves to the first member exporting it (overlays
+     *  before the base, vendor fallbacks last), optionally falling
+     *  back to the process-wide scope. Winners and misses are
+     *  memoized; any member loading again or unloading drops them.
+     *--------------------------------------------------------------*/
+    class LibraryScope {
+    public:
+        struct Resolution {
+            void* address = nullptr;                // nullptr: no member exports the name
+            SharedLibraryBase* provider = nullptr;  // nullptr with an address: the process-wide scope
+        };
+
+        LibraryScope() = default;
+
+        /** Members in precedence order; processDefault searches the process-wide scope after all of them */
+        explicit LibraryScope(const std::vector<SharedLibraryBase*>& members, bool processDefault = false)
+            : processDefault_(processDefault) {
+            for (SharedLibraryBase* lib : members) {
+                add(*lib);
+            }
+        }
+
+        LibraryScope(const LibraryScope&) = delete;
+        LibraryScope& operator=(const LibraryScope&) = delete;
+
+        /** Append a member below every existing one (still above the process-wide scope) */
+        inline LibraryScope& add(SharedLibraryBase& lib) {
+            std::lock_guard<std::mutex> g(lock_);
+            members_.push_back({ &lib, lib.generation() });
+            memo_.clear();
+            return *this;
+        }
+
+        /** Search the process-wide scope (RTLD_DEFAULT; on Windows the executable's exports) last */
+        inline LibraryScope& addProcessDefault() {
+            std::lock_guard<std::mutex> g(lock_);
+            processDefault_ = true;
+            memo_.clear();
+            return *this;
+        }
+
+        /** Drop every memoized result; needed only when the process-wide scope changed (a new RTLD_GLOBAL load) */
+        inline void invalidate() {
+            std::lock_guard<std::mutex> g(lock_);
+            memo_.clear();
+        }
+
+        inline size_t size() const {
+            std::lock_guard<std::mutex> g(lock_);
+            return members_.size();
+        }
+
+        /** Winning provider of `name`; delay-loaded members load as the search reaches them, unloaded ones are skipped */
+        inline Resolution resolve(const char* name) {
+            std::lock_guard<std::mutex> g(lock_);
+            refresh();
+            return lookup(name);
+        }
+
+        /** Bulk resolution in one pass over the memo; results follow `names` */
+        inline std::vector<Resolution> resolve(const std::vector<std::string>& names) {
+            std::vector<Resolution> out;
+            out.reserve(names.size());
+            std::lock_guard<std::mutex> g(lock_);
+            refresh();
+            for (const std::string& name : names) {
+                out.push_back(lookup(name.c_str()));
+            }
+            return out;
+        }
+
+        /** nullptr when no member exports the name */
+        template<class _Func>
+        inline _Func tryGet(const char* name) {
+            return reinterpret_cast<_Func>(resolve(name).address);
+        }
+
+        template<class _Func>
+        inline _Func get(const char* name) {
+            void* p = resolve(name).address;
+            if (!p) {
+                throw std::runtime_error("LibraryScope::get failed – " + std::string(name));
+            }
+            return reinterpret_cast<_Func>(p);
+        }
+
+        template<class _Func>
+        inline void get(const char* name, _Func& out) {
+            out = get<_Func>(name);
+        }
+
+        /** Binding list, e.g. batchLoad(bind("init", init), bind("run", run)); all or nothing, missing names in the error */
+        template<class... Bindings>
+        inline void batchLoad(Bindings&&... bindings) {
+            const char* names[] = { bindings.name..., nullptr };
+            void* found[sizeof...(Bindings) + 1] = {};
+            std::string missing;
+            {
+                std::lock_guard<std::mutex> g(lock_);
+                refresh();
+                for (size_t i = 0; i < sizeof...(Bindings); ++i) {
+                    found[i] = lookup(names[i]).address;
+                    if (!found[i]) {
+                        missing += (missing.empty() ? "" : ", ") + std::string(names[i]);
+                    }
+                }
+            }
+            if (!missing.empty()) {
+                throw std::runtime_error("LibraryScope::batchLoad failed – " + missing);
+            }
+            size_t i = 0;
+            (assign(bindings, found[i++]), ...);
+        }
+
+    private:
+        template<class _Func>
+        static inline void assign(const _FuncBinding<_Func>& binding, void* p) {
+            *binding.ptr = reinterpret_cast<_Func>(p);
+        }
+
+        struct Member {
+            SharedLibraryBase* lib;
+            uint64_t generation;        // As of the memo; 0: not loaded yet, so nothing memoized came from it
+        };
+
+        /** A member that moved since the memo was taken invalidates it; a first load does not */
+        inline void refresh() {
+            bool stale = false;
+            for (Member& m : members_) {
+                const uint64_t now = m.lib->generation();
+                if (now != m.generation) {
+                    stale |= m.generation != 0;
+                    m.generation = now;
+                }
+            }
+            if (stale) {
+                memo_.clear();
+            }
+        }
+
+        inline Resolution lookup(const char* name) {
+            auto it = memo_.find(name);
+            if (it != memo_.end()) {
+                return it->second;
+            }
+            Resolution r;
+            for (Member& m : members_) {
+                if (void* p = m.lib->tryGet<void*>(name)) {
+                    r = { p, m.lib };
+                    break;
+                }
+            }
+            if (!r.address && processDefault_) {
+#if defined(_WIN32)
+                r.address = reinterpret_cast<void*>(::GetProcAddress(::GetModuleHandleW(nullptr), name));
+#else
+                r.address = ::dlsym(RTLD_DEFAULT, name);
+#endif
+            }
+            // tryGet() may have loaded members on the way: that first load does not invalidate
+            for (Member& m : members_) {
+                if (m.generation == 0) {
+                    m.generation = m.lib->generation();
+                }
+            }
+            memo_.emplace(name, r);
+            return r;
+        }
+
+        mutable std::mutex lock_;
+        std::vector<Member> members_;
+        bool processDefault_ = false;
+        std::unordered_map<std::string, Resolution> memo_;     // Name -> winner, or a memoized miss
+    };
+
+    namespace detail {
+
+    /** Intrusive Vyukov MPSC queue: any thread pushes, one consumer pops. _Node has std::atomic<_Node*> next. */
+    template<class _Node, class _Stub = _Node>
+    class MpscQueue {
+    public:
+        MpscQueue() = default;
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        inline void push(_Node* n) noexcept {
+            n->next.store(nullptr, std::memory_order_relaxed);
+            _Node* prev = tail_.exchange(n, std::memory_order_acq_rel);
+            prev->next.store(n, std::memory_order_release);
+        }
+
+        /** Consumer only; nullptr when empty or a push is mid-flight */
+        inline _Node* pop() noexcept {
+            _Node* head = head_;
+            _Node* next = head->next.load(std::memory_order_acquire);
+            if (head == stub()) {
+                if (!next) {
+                    return nullptr;
+                }
+                head_ = head = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+            if (next) {
+                head_ = next;
+                return head;
+            }
+            if (head != tail_.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            push(stub());               // Re-insert the stub so the last real node can be handed out
+            next = head->next.load(std::memory_order_acquire);
+            if (next) {
+                head_ = next;
+                return head;
+            }
+            return nullptr;
+        }
+
+        /** Consumer only */
+        inline bool empty() const noexcept {
+            return head_ == stub() && !stub_.next.load();
+        }
+
+    private:
+        inline _Node* stub() noexcept { return &stub_; }
+        inline const _Node* stub() const noexcept { return &stub_; }
+
+        _Stub stub_;
+        std::atomic<_Node*> tail_{ &stub_ };
+        _Node* head_ = &stub_;          // Consumer only
+    };
+
+    /** Sleep/wake handshake of a queue's single consumer. The fences order each
+     *  side's store before its load (Dekker): either the producer sees the sleeper,
+     *  or the consumer sees the pushed work; never neither. */
+    class IdleGate {
+    public:
+        /** Producer, after the push */
+        inline void notify() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleeping_.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> g(lock_);
+                sleeping_.store(false, std::memory_order_relaxed);
+                wake_.notify_one();
+            }
+        }
+
+        /** Consumer: sleep until notify(), unless ready() already holds once the sleep is announced */
+        template<class _Ready>
+        inline void wait(_Ready ready) {
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready()) {
+                sleeping_.store(false, std::memory_order_relaxed);
+                return;
+            }
+            std::unique_lock<std::mutex> lk(lock_);
+            wake_.wait(lk, [this] { return !sleeping_.load(std::memory_order_relaxed); });
+        }
+
+    private:
+        std::atomic<bool> sleeping_{ false };
+        std::mutex lock_;
+        std::condition_variable wake_;
+    };
+
+    }   // namespace detail
+
+    /*--------------------------------------------------------------
+     *  Single-owner executor for non-thread-safe libraries
+     *  Every call runs on one owner thread. Producers push onto a
+     *  lock-free intrusive MPSC queue (Vyukov); the owner drains it in
+     *  batches and only takes a mutex to sleep when it runs dry.
+     *--------------------------------------------------------------*/
+    struct ExecutorOptions {
+        size_t capacity = 4096;         // Queued calls before backpressure applies
+        size_t batchSize = 64;          // Calls drained per batch
+        bool blockWhenFull = true;      // Block producers (true) or throw (false) at capacity
+    };
+
+    struct ExecutorStats {
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t rejected = 0;          // Refused at capacity (blockWhenFull == false)
+        uint64_t failed = 0;            // post() calls that threw
+        uint64_t batches = 0;
+        size_t depth = 0;               // Calls queued right now
+        size_t maxDepth = 0;            // High-water mark of depth
+    };
+
+    class LibraryExecutor {
+    public:
+        explicit LibraryExecutor(SharedLibraryBase& lib, ExecutorOptions options = ExecutorOptions())
+            : lib_(lib), options_(options) {
+            options_.capacity = options_.capacity ? options_.capacity : 1;
+            options_.batchSize = options_.batchSize ? options_.batchSize : 1;
+            owner_ = std::thread([this] { run(); });
+            // Library constructors run on the owner too; a failure is rethrown by the next submit()/call()/post()
+            auto load = std::make_unique<LoadTask>(*this);
+            loaded_ = load->promise.get_future().share();
+            enqueue(std::move(load), false);
+        }
+
+        /** Drains queued calls, then joins the owner thread */
+        ~LibraryExecutor() {
+            enqueue(std::make_unique<PostTask<StopFn>>([this](SharedLibraryBase&) { stopping_ = true; }), false);
+            owner_.join();
+            while (Task* t = queue_.pop()) {
+                delete t;
+            }
+        }
+
+        LibraryExecutor(const LibraryExecutor&) = delete;
+        LibraryExecutor& operator=(const LibraryExecutor&) = delete;
+
+        /** Run fn(lib) on the owner thread */
+        template<class _Fn>
+        inline auto submit(_Fn&& fn) -> std::future<std::invoke_result_t<_Fn&, SharedLibraryBase&>> {
+            using R = std::invoke_result_t<_Fn&, SharedLibraryBase&>;
+            checkLoaded();
+            auto task = std::make_unique<CallTask<std::decay_t<_Fn>, R>>(std::forward<_Fn>(fn));
+            std::future<R> f = task->promise.get_future();
+            enqueue(std::move(task));
+            return f;
+        }
+
+        /** Resolve an export on the owner thread (cached there) and call it */
+        template<class _Func, class... _Args>
+        inline auto call(const char* name, _Args&&... args) {
+            return submit([this, name, tup = std::make_tuple(std::forward<_Args>(args)...)](SharedLibraryBase& lib) mutable {
+                auto fn = reinterpret_cast<_Func>(resolve<_Func>(lib, name));
+                return std::apply(fn, std::move(tup));
+            });
+        }
+
+        /** Fire-and-forget fn(lib) on the owner thread; what it throws is counted and kept (lastError) */
+        template<class _Fn>
+        inline void post(_Fn&& fn) {
+            checkLoaded();
+            enqueue(std::make_unique<PostTask<std::decay_t<_Fn>>>(std::forward<_Fn>(fn)));
+        }
+
+#if defined(__cpp_impl_coroutine)
+        /** co_await executor.async(fn): fn(lib) runs on the owner thread, which also resumes the coroutine */
+        template<class _Fn>
+        inline auto async(_Fn&& fn) {
+            using R = std::invoke_result_t<_Fn&, SharedLibraryBase&>;
+            struct Awaiter {
+                LibraryExecutor* ex;
+                std::decay_t<_Fn> fn;
+                std::conditional_t<std::is_void_v<R>, bool, std::optional<R>> result{};
+                std::exception_ptr error;
+
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> h) {
+                    ex->post([this, h](SharedLibraryBase& lib) {
+                        try {
+                            if constexpr (std::is_void_v<R>) {
+                                fn(lib);
+                            } else {
+                                result.emplace(fn(lib));
+                            }
+                        } catch (...) {
+                            error = std::current_exception();
+                        }
+                        h.resume();
+                    });
+                }
+                R await_resume() {
+                    if (error) {
+                        std::rethrow_exception(error);
+                    }
+                    if constexpr (!std::is_void_v<R>) {
+                        return std::move(*result);
+                    }
+                }
+            };
+            return Awaiter{ this, std::forward<_Fn>(fn) };
+        }
+#endif
+
+        /** Queue-depth and throughput counters */
+        inline ExecutorStats stats() const noexcept {
+            ExecutorStats s;
+            s.submitted = submitted_.load(std::memory_order_relaxed);
+            s.completed = completed_.load(std::memory_order_relaxed);
+            s.rejected = rejected_.load(std::memory_order_relaxed);
+            s.failed = failed_.load(std::memory_order_relaxed);
+            s.batches = batches_.load(std::memory_order_relaxed);
+            s.depth = depth_.load(std::memory_order_relaxed);
+            s.maxDepth = maxDepth_.load(std::memory_order_relaxed);
+            return s;
+        }
+
+        inline bool onOwnerThread() const noexcept {
+            return std::this_thread::get_id() == owner_.get_id();
+        }
+
+        /** Ready once the initial load ran on the owner; get() rethrows its failure */
+        inline std::shared_future<void> loaded() const {
+            return loaded_;
+        }
+
+        /** Latest exception thrown by a post() call, or nullptr */
+        inline std::exception_ptr lastError() const {
+            std::lock_guard<std::mutex> g(lock_);
+            return lastError_;
+        }
+
+    private:
+        struct Task {
+            std::atomic<Task*> next{ nullptr };
+            std::exception_ptr error;       // Thrown by a fire-and-forget task
+            virtual ~Task() = default;
+            virtual void run(SharedLibraryBase& lib) = 0;
+        };
+
+        template<class _Fn, class _R>
+        struct CallTask final : Task {
+            explicit CallTask(_Fn&& f) : fn(std::move(f)) {}
+            explicit CallTask(const _Fn& f) : fn(f) {}
+            void run(SharedLibraryBase& lib) override {
+                try {
+                    if constexpr (std::is_void_v<_R>) {
+                        fn(lib);
+                        promise.set_value();
+                    } else {
+                        promise.set_value(fn(lib));
+                    }
+                } catch (...) {
+                    promise.set_exception(std::current_exception());
+                }
+            }
+            _Fn fn;
+            std::promise<_R> promise;
+        };
+
+        template<class _Fn>
+        struct PostTask final : Task {
+            explicit PostTask(_Fn&& f) : fn(std::move(f)) {}
+            explicit PostTask(const _Fn& f) : fn(f) {}
+            void run(SharedLibraryBase& lib) override {
+                try {
+                    fn(lib);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+            _Fn fn;
+        };
+
+        struct LoadTask final : Task {
+            explicit LoadTask(LibraryExecutor& e) : executor(e) {}
+            void run(SharedLibraryBase& lib) override {
+                try {
+                    lib.ensureLoaded();
+                    promise.set_value();
+                } catch (...) {
+                    executor.loadFailed_.store(true, std::memory_order_release);    // Before the future turns ready
+                    promise.set_exception(std::current_exception());
+                }
+            }
+            LibraryExecutor& executor;
+            std::promise<void> promise;
+        };
+
+        struct Stub final : Task {
+            void run(SharedLibraryBase&) override {}
+        };
+
+        template<class _Func>
+        inline void* resolve(SharedLibraryBase& lib, const char* name) {
+            if (lib.generation() != symbolsGeneration_) {
+                symbols_.clear();           // Unloaded or reloaded since: cached addresses are stale
+            }
+            auto it = symbols_.find(name);
+            if (it != symbols_.end()) {
+                return it->second;
+            }
+            void* p = reinterpret_cast<void*>(lib.get<_Func>(name));
+            symbolsGeneration_ = lib.generation();
+            symbols_.emplace(name, p);
+            return p;
+        }
+
+        /** Rethrow a failed initial load to the caller instead of queuing work for an unloaded library */
+        inline void checkLoaded() const {
+            if (loadFailed_.load(std::memory_order_acquire)) {
+                loaded_.get();
+            }
+        }
+
+        inline void finish(Task* t) {
+            if (!t->error) {
+                return;
+            }
+            failed_.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> g(lock_);
+            lastError_ = t->error;
+        }
+
+        using StopFn = std::function<void(SharedLibraryBase&)>;
+
+        inline void enqueue(std::unique_ptr<Task> task, bool limited = true) {
+            if (onOwnerThread()) {
+                task->run(lib_);            // A call from a call: queuing it would deadlock on its future
+                finish(task.get());
+                return;
+            }
+            if (limited) {
+                reserve();
+            } else {
+                depth_.fetch_add(1, std::memory_order_acq_rel);     // Lifecycle markers bypass backpressure
+            }
+            queue_.push(task.release());
+            submitted_.fetch_add(1, std::memory_order_relaxed);
+            gate_.notify();
+        }
+
+        // Backpressure: take a queue slot or block/throw
+        inline void reserve() {
+            for (;;) {
+                const size_t d = depth_.fetch_add(1, std::memory_order_acq_rel) + 1;
+                if (d <= options_.capacity) {
+                    size_t m = maxDepth_.load(std::memory_order_relaxed);
+                    while (d > m && !maxDepth_.compare_exchange_weak(m, d, std::memory_order_relaxed)) {}
+                    return;
+                }
+                depth_.fetch_sub(1, std::memory_order_acq_rel);
+                if (!options_.blockWhenFull) {
+                    rejected_.fetch_add(1, std::memory_order_relaxed);
+                    throw std::runtime_error("LibraryExecutor queue full");
+                }
+                std::unique_lock<std::mutex> lk(lock_);
+                blocked_.fetch_add(1);
+                space_.wait(lk, [this] { return depth_.load() < options_.capacity; });
+                blocked_.fetch_sub(1);
+            }
+        }
+
+        inline void run() {
+            std::vector<Task*> batch;
+            batch.reserve(options_.batchSize);
+            while (!stopping_) {
+                while (batch.size() < options_.batchSize) {
+                    Task* t = queue_.pop();
+                    if (!t) {
+                        break;
+                    }
+                    batch.push_back(t);
+                }
+                if (batch.empty()) {
+                    idle();
+                    continue;
+                }
+                for (Task* t : batch) {
+                    t->run(lib_);
+                    finish(t);
+                    delete t;
+                }
+                depth_.fetch_sub(batch.size(), std::memory_order_acq_rel);
+                completed_.fetch_add(batch.size(), std::memory_order_relaxed);
+                batches_.fetch_add(1, std::memory_order_relaxed);
+                batch.clear();
+                if (blocked_.load()) {
+                    std::lock_guard<std::mutex> g(lock_);
+                    space_.notify_all();
+                }
+            }
+        }
+
+        inline void idle() {
+            for (int spin = 0; spin < 64; ++spin) {
+                if (!queue_.empty()) {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+            gate_.wait([this] { return !queue_.empty(); });
+        }
+
+        SharedLibraryBase& lib_;
+        ExecutorOptions options_;
+        detail::MpscQueue<Task, Stub> queue_;
+        std::unordered_map<std::string, void*> symbols_;    // Owner thread only
+        uint64_t symbolsGeneration_ = 0;                    // lib_.generation() symbols_ was filled at; owner thread only
+        bool stopping_ = false;                             // Owner thread only
+        std::thread owner_;
+        mutable std::mutex lock_;
+        std::condition_variable space_;
+        detail::IdleGate gate_;
+        std::atomic<size_t> blocked_{ 0 };                  // Producers waiting for space
+        std::shared_future<void> loaded_;                   // Initial load on the owner
+        std::atomic<bool> loadFailed_{ false };
+        std::exception_ptr lastError_;                      // Under lock_
+        std::atomic<size_t> depth_{ 0 }, maxDepth_{ 0 };
+        std::atomic<uint64_t> submitted_{ 0 }, completed_{ 0 }, rejected_{ 0 }, failed_{ 0 }, batches_{ 0 };
+    };
+
+    /*--------------------------------------------------------------
+     *  Loader service: one thread does all dynamic-linker work
+     *  Requests go onto one lock-free MPSC queue per priority class.
+     *  The loader always drains the most urgent class first and
+     *  coalesces identical requests of a batch into one operation.
+     *--------------------------------------------------------------*/
+    enum class LoadPriority : unsigned {
+        Critical = 0,       // A caller is blocked on it
+        Normal = 1,
+        Background = 2      // Preloads, unloads
+    };
+
+    struct LoaderClassStats {
+        uint64_t requests = 0;
+        uint64_t executed = 0;          // Operations actually run
+        uint64_t coalesced = 0;         // Answered by an identical request, or already in that state
+        double waitMeanNs = 0;          // Queue wait: submit -> picked up by the loader
+        uint64_t waitP50Ns = 0;
+        uint64_t waitP99Ns = 0;
+        uint64_t waitMaxNs = 0;
+    };
+
+    struct LoaderStats {
+        LoaderClassStats classes[3];    // Indexed by LoadPriority
+        uint64_t batches = 0;
+        uint64_t busyNs = 0;            // Loader thread time spent in requests
+    };
+
+    class LoaderService : private detail::LoaderRoute {
+    public:
+        static constexpr size_t kBatch = 32;
+
+        LoaderService() : thread_([this] { run(); }) {}
+
+        /** Uninstalls, waits out routed calls, finishes every queued request, then joins */
+        ~LoaderService() {
+            LoaderRoute* self = this;
+            detail::loaderRoute().compare_exchange_strong(self, nullptr);
+            detail::quiesceLoaderRoute();       // Callers that read the route before it was cleared
+            stopping_.store(true);
+            gate_.notify();
+            thread_.join();
+            for (auto& q : queues_) {
+                while (Request* r = q.pop()) {  // Raced the stop: refuse rather than leave the future hanging
+                    refuse(*r);
+                    delete r;
+                }
+            }
+        }
+
+        LoaderService(const LoaderService&) = delete;
+        LoaderService& operator=(const LoaderService&) = delete;
+
+        /** Route every SharedLibraryBase::loadNow()/unload() in the process through `service` (nullptr: stop) */
+        static inline void install(LoaderService* service) noexcept {
+            detail::loaderRoute().store(service, std::memory_order_release);
+        }
+
+        inline std::future<void> load(SharedLibraryBase& lib, LoadPriority priority = LoadPriority::Normal) {
+            return std::move(submit(Op::Load, lib, {}, priority).done);
+        }
+
+        inline std::future<void> unload(SharedLibraryBase& lib, LoadPriority priority = LoadPriority::Background) {
+            return std::move(submit(Op::Unload, lib, {}, priority).done);
+        }
+
+        /** Load if needed and look up `names` in one trip; absent symbols come back as nullptr */
+        inline std::future<std::vector<void*>> resolve(SharedLibraryBase& lib, std::vector<std::string> names,
+                                                       LoadPriority priority = LoadPriority::Normal) {
+            return std::move(submit(Op::Resolve, lib, std::move(names), priority).symbols);
+        }
+
+        inline LoaderStats stats() const {
+            LoaderStats out;
+            for (size_t c = 0; c < 3; ++c) {
+                const ClassCounters& k = counters_[c];
+                LoaderClassStats& o = out.classes[c];
+                o.requests = k.requests.load(std::memory_order_relaxed);
+                o.executed = k.executed.load(std::memory_order_relaxed);
+                o.coalesced = k.coalesced.load(std::memory_order_relaxed);
+                o.waitMaxNs = k.waitMaxNs.load(std::memory_order_relaxed);
+                uint64_t n = 0, buckets[48];
+                for (size_t b = 0; b < 48; ++b) {
+                    buckets[b] = k.waitBuckets[b].load(std::memory_order_relaxed);
+                    n += buckets[b];
+                }
+                o.waitMeanNs = n ? double(k.waitSumNs.load(std::memory_order_relaxed)) / double(n) : 0.0;
+                o.waitP50Ns = std::min(o.waitMaxNs, percentile(buckets, n, 0.50));
+                o.waitP99Ns = std::min(o.waitMaxNs, percentile(buckets, n, 0.99));
+            }
+            out.batches = batches_.load(std::memory_order_relaxed);
+            out.busyNs = busyNs_.load(std::memory_order_relaxed);
+            return out;
+        }
+
+        inline bool onLoaderThread() const noexcept override {
+            return std::this_thread::get_id() == thread_.get_id();
+        }
+
+    private:
+        enum class Op { Load, Unload, Resolve };
+
+        struct Request {
+            std::atomic<Request*> next{ nullptr };
+            Op op = Op::Load;
+            SharedLibraryBase* lib = nullptr;
+            std::vector<std::string> names;
+            std::chrono::steady_clock::time_point queued;
+            std::promise<void> done;
+            std::promise<std::vector<void*>> symbols;
+        };
+
+        struct Futures {
+            std::future<void> done;
+            std::future<std::vector<void*>> symbols;
+        };
+
+        struct alignas(64) ClassCounters {
+            std::atomic<uint64_t> requests{ 0 }, executed{ 0 }, coalesced{ 0 };
+            std::atomic<uint64_t> waitSumNs{ 0 }, waitMaxNs{ 0 };
+            std::atomic<uint64_t> waitBuckets[48] = {};     // log2(ns)
+        };
+
+        inline void loadOn(SharedLibraryBase& lib) override {
+            submit(Op::Load, lib, {}, LoadPriority::Critical).done.get();
+        }
+
+        inline void unloadOn(SharedLibraryBase& lib) override {
+            submit(Op::Unload, lib, {}, LoadPriority::Normal).done.get();
+        }
+
+        inline Futures submit(Op op, SharedLibraryBase& lib, std::vector<std::string> names, LoadPriority priority) {
+            auto r = std::make_unique<Request>();
+            r->op = op;
+            r->lib = &lib;
+            r->names = std::move(names);
+            Futures f{ r->done.get_future(), r->symbols.get_future() };    // Before the push: the loader deletes r
+            if (stopping_.load()) {
+                refuse(*r);
+                return f;
+            }
+            const size_t c = static_cast<size_t>(priority) < 3 ? static_cast<size_t>(priority) : 2;
+            counters_[c].requests.fetch_add(1, std::memory_order_relaxed);
+            r->queued = std::chrono::steady_clock::now();
+            queues_[c].push(r.release());
+            gate_.notify();
+            return f;
+        }
+
+        static inline void refuse(Request& r) {
+            const auto error = std::make_exception_ptr(std::runtime_error("LoaderService failed – service is stopping"));
+            r.done.set_exception(error);
+            r.symbols.set_exception(error);
+        }
+
+        inline bool anyQueued() const noexcept {
+            return !queues_[0].empty() || !queues_[1].empty() || !queues_[2].empty();
+        }
+
+        inline void run() {
+            std::vector<Request*> batch;
+            batch.reserve(kBatch);
+            for (;;) {
+                // Most urgent non-empty class only; re-checked after every batch
+                size_t c = 0;
+                for (; c < 3; ++c) {
+                    while (batch.size() < kBatch) {
+                        Request* r = queues_[c].pop();
+                        if (!r) {
+                            break;
+                        }
+                        batch.push_back(r);
+                    }
+                    if (!batch.empty()) {
+                        break;
+                    }
+                }
+                if (batch.empty()) {
+                    if (stopping_.load() && !anyQueued()) {
+                        return;
+                    }
+                    idle();
+                    continue;
+                }
+                execute(c, batch);
+                batch.clear();
+            }
+        }
+
+        inline void execute(size_t c, std::vector<Request*>& batch) {
+            const auto start = std::chrono::steady_clock::now();
+            ClassCounters& k = counters_[c];
+            for (Request* r : batch) {
+                const uint64_t wait = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(start - r->queued).count());
+                k.waitSumNs.fetch_add(wait, std::memory_order_relaxed);
+                if (wait > k.waitMaxNs.load(std::memory_order_relaxed)) {
+                    k.waitMaxNs.store(wait, std::memory_order_relaxed);
+                }
+                size_t b = 0;
+                while (b + 1 < 48 && (uint64_t(1) << (b + 1)) <= wait) {
+                    ++b;
+                }
+                k.waitBuckets[b].fetch_add(1, std::memory_order_relaxed);
+            }
+            // Identical (op, lib) requests share one run until the opposite op runs on that library;
+            // lookups share one symbol cache per library, dropped by its unload
+            std::map<std::pair<int, SharedLibraryBase*>, std::exception_ptr> ran;
+            std::map<std::pair<SharedLibraryBase*, std::string>, void*> looked;
+            for (Request* r : batch) {
+                const auto key = std::make_pair(static_cast<int>(r->op == Op::Resolve ? Op::Load : r->op), r->lib);
+                auto it = ran.find(key);
+                const bool noop = it == ran.end() && r->lib->isLoaded() == (r->op != Op::Unload);
+                if (noop) {
+                    it = ran.emplace(key, nullptr).first;       // Already in the requested state
+                    k.coalesced.fetch_add(1, std::memory_order_relaxed);
+                } else if (it == ran.end()) {
+                    std::exception_ptr error;
+                    try {
+                        if (r->op == Op::Unload) {
+                            r->lib->unload();
+                        } else {
+                            r->lib->loadNow();
+                        }
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    ran.erase(std::make_pair(static_cast<int>(r->op == Op::Unload ? Op::Load : Op::Unload), r->lib));
+                    if (r->op == Op::Unload) {
+                        for (auto l = looked.lower_bound({ r->lib, std::string() }); l != looked.end() && l->first.first == r->lib;) {
+                            l = looked.erase(l);
+                        }
+                    }
+                    it = ran.emplace(key, error).first;
+                    k.executed.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    k.coalesced.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (r->op != Op::Resolve) {
+                    if (it->second) {
+                        r->done.set_exception(it->second);
+                    } else {
+                        r->done.set_value();
+                    }
+                } else if (it->second) {
+                    r->symbols.set_exception(it->second);
+                } else {
+                    std::vector<void*> out;
+                    out.reserve(r->names.size());
+                    for (const std::string& name : r->names) {
+                        auto found = looked.find({ r->lib, name });
+                        if (found == looked.end()) {
+                            found = looked.emplace(std::make_pair(r->lib, name), r->lib->tryGet<void*>(name.c_str())).first;
+                        }
+                        out.push_back(found->second);
+                    }
+                    r->symbols.set_value(std::move(out));
+                }
+                delete r;
+            }
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            busyNs_.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count()), std::memory_order_relaxed);
+        }
+
+        inline void idle() {
+            gate_.wait([this] { return anyQueued() || stopping_.load(); });
+        }
+
+        static inline uint64_t percentile(const uint64_t* buckets, uint64_t n, double p) noexcept {
+            if (!n) {
+                return 0;
+            }
+            const uint64_t rank = static_cast<uint64_t>(std::ceil(p * double(n)));
+            uint64_t seen = 0;
+            for (size_t b = 0; b < 48; ++b) {
+                seen += buckets[b];
+                if (seen >= rank) {
+                    return (uint64_t(1) << (b + 1)) - 1;    // Bucket upper bound
+                }
+            }
+            return ~uint64_t(0);
+        }
+
+        detail::MpscQueue<Request> queues_[3];
+        ClassCounters counters_[3];
+        std::atomic<uint64_t> batches_{ 0 }, busyNs_{ 0 };
+        std::atomic<bool> stopping_{ false };
+        detail::IdleGate gate_;
+        std::thread thread_;            // Last: starts after everything above exists
+    };
+
+    /*--------------------------------------------------------------
+     *  Predictive preloading
+     *  A first-order Markov model over observed loads, plus the
+     *  symbols each library was asked for. After a load whose likely
+     *  successors are known, those successors are loaded and
+     *  pre-resolved on a niced background thread, within memory and
+     *  CPU budgets. A later real load of the same path finds the
+     *  object already mapped: a hit. Speculation left unused until it
+     *  expires is counted as waste.
+     *--------------------------------------------------------------*/
+    struct PredictorOptions {
+        std::string modelPath;                          // Persisted model; "" keeps it in memory
+        double threshold = 0.6;                         // P(next | current) needed to speculate
+        unsigned minObservations = 3;                   // Transitions seen out of a library before trusting it
+        unsigned maxCandidates = 2;                     // Successors preloaded per load
+        size_t memoryBudget = size_t(64) << 20;         // File bytes held speculatively
+        std::chrono::milliseconds cpuBudget{ 100 };     // Speculative load time allowed per second
+        std::chrono::seconds expiry{ 30 };              // Unused speculation older than this is waste
+        std::chrono::seconds window{ 10 };              // Loads further apart are not a transition
+        size_t maxSymbols = 64;                         // Lookups remembered per library
+    };
+
+    struct PredictorStats {
+        uint64_t observedLoads = 0;
+        uint64_t speculated = 0;        // Speculative loads completed
+        uint64_t hits = 0;              // ... later loaded for real
+        uint64_t wasted = 0;            // ... expired or failed unused
+        uint64_t skippedBudget = 0;     // Confident predictions not acted on for budget
+        double hitRate = 0;             // hits / (hits + wasted)
+        uint64_t usefulNs = 0;          // Background load time that turned into hits
+        uint64_t wastedNs = 0;
+    };
+
+    class LoadPredictor : private detail::LoadObserver {
+    public:
+        explicit LoadPredictor(PredictorOptions options = PredictorOptions())
+            : options_(std::move(options)) {
+            if (!options_.modelPath.empty()) {
+                loadModel();
+            }
+            worker_ = std::thread([this] { work(); });
+        }
+
+        /** Uninstalls, stops speculating, saves the model */
+        ~LoadPredictor() {
+            detail::LoadObserver* self = this;
+            detail::loadObserver().compare_exchange_strong(self, nullptr);
+            detail::quiesceLoadObserver();      // Callbacks that read the pointer before it was cleared
+            {
+                std::lock_guard<std::mutex> g(lock_);
+                stopping_ = true;
+            }
+            wake_.notify_all();
+            worker_.join();
+            if (!options_.modelPath.empty()) {
+                try {
+                    save();
+                } catch (...) {
+                }
+            }
+        }
+
+        LoadPredictor(const LoadPredictor&) = delete;
+        LoadPredictor& operator=(const LoadPredictor&) = delete;
+
+        /** Observe every load/lookup in the process (nullptr: stop); returns once the previous observer's calls have drained */
+        static inline void install(LoadPredictor* predictor) noexcept {
+            detail::loadObserver().store(predictor);
+            detail::quiesceLoadObserver();
+        }
+
+        /** Write the model to options.modelPath */
+        inline void save() const {
+            std::lock_guard<std::mutex> g(lock_);
+            FILE* f = std::fopen(options_.modelPath.c_str(), "w");
+            if (!f) {
+                throw std::runtime_error("LoadPredictor::save failed – " + options_.modelPath);
+            }
+            std::fprintf(f, "# sharedlibrary predictor v1\n");
+            for (const auto& from : model_) {
+                for (const auto& to : from.second.next) {
+                    std::fprintf(f, "T\t%s\t%s\t%llu\n", from.first.c_str(), to.first.c_str(), (unsigned long long)to.second);
+                }
+                for (const std::string& sym : from.second.symbols) {
+                    std::fprintf(f, "S\t%s\t%s\n", from.first.c_str(), sym.c_str());
+                }
+            }
+            std::fclose(f);
+        }
+
+        /** Likely successors of `path` with their probability, most likely first */
+        inline std::vector<std::pair<std::string, double>> predict(const std::string& path) const {
+            std::lock_guard<std::mutex> g(lock_);
+            return predictLocked(path);
+        }
+
+        inline PredictorStats stats() const {
+            std::lock_guard<std::mutex> g(lock_);
+            PredictorStats s = stats_;
+            s.hitRate = s.hits + s.wasted ? double(s.hits) / double(s.hits + s.wasted) : 0.0;
+            return s;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Node {
+            std::map<std::string, uint64_t> next;
+            uint64_t total = 0;
+            std::vector<std::string> symbols;       // In first-seen order
+        };
+
+        struct Speculation {
+            std::unique_ptr<SharedLibraryBase> lib;     // Null while loading
+            size_t bytes = 0;
+            uint64_t costNs = 0;
+            Clock::time_point at;
+        };
+
+        inline void onLoad(const SharedLibraryBase& lib) override {
+            std::lock_guard<std::mutex> g(lock_);
+            if (ours_.count(&lib)) {
+                return;
+            }
+            const std::string& path = lib.path();
+            const auto now = Clock::now();
+            ++stats_.observedLoads;
+
+            auto spec = speculative_.find(path);
+            if (spec != speculative_.end()) {
+                if (spec->second.lib) {
+                    ++stats_.hits;
+                    stats_.usefulNs += spec->second.costNs;
+                    retire(spec);
+                } else {                        // Overtaken while still loading
+                    heldBytes_ -= spec->second.bytes;
+                    speculative_.erase(spec);
+                }
+            }
+            if (!last_.empty() && now - lastAt_ <= options_.window && last_ != path) {
+                Node& n = model_[last_];
+                ++n.next[path];
+                if (++n.total > 1000) {         // Decay so the model follows changing habits
+                    n.total = 0;
+                    for (auto& t : n.next) {
+                        t.second /= 2;
+                        n.total += t.second;
+                    }
+                }
+            }
+            last_ = path;
+            lastAt_ = now;
+            expire(now);
+            speculate(path, now);
+        }
+
+        inline void onResolve(const SharedLibraryBase& lib, const char* symbol) override {
+            std::lock_guard<std::mutex> g(lock_);
+            if (ours_.count(&lib)) {
+                return;
+            }
+            Node& n = model_[lib.path()];
+            if (n.symbols.size() < options_.maxSymbols &&
+                std::find(n.symbols.begin(), n.symbols.end(), symbol) == n.symbols.end()) {
+                n.symbols.emplace_back(symbol);
+            }
+        }
+
+        inline std::vector<std::pair<std::string, double>> predictLocked(const std::string& path) const {
+            std::vector<std::pair<std::string, double>> out;
+            auto it = model_.find(path);
+            if (it == model_.end() || it->second.total == 0) {
+                return out;
+            }
+            for (const auto& t : it->second.next) {
+                out.emplace_back(t.first, double(t.second) / double(it->second.total));
+            }
+            std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+            return out;
+        }
+
+        /** Queue background loads of confident successors that fit the budgets */
+        inline void speculate(const std::string& path, Clock::time_point now) {
+            auto it = model_.find(path);
+            if (it == model_.end() || it->second.total < options_.minObservations) {
+                return;
+            }
+            if (now - cpuWindow_ >= std::chrono::seconds(1)) {
+                cpuWindow_ = now;
+                cpuSpentNs_ = 0;
+            }
+            unsigned queued = 0;
+            for (const auto& candidate : predictLocked(path)) {
+                if (candidate.second < options_.threshold || queued == options_.maxCandidates) {
+                    break;
+                }
+                const std::string& next = candidate.first;
+                if (speculative_.count(next) || loadedAnywhere(next)) {
+                    continue;
+                }
+                // The file size is checked against the memory budget on the worker: no I/O under lock_
+                if (heldBytes_ >= options_.memoryBudget ||
+                    cpuSpentNs_ >= uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(options_.cpuBudget).count())) {
+                    ++stats_.skippedBudget;
+                    continue;
+                }
+                Speculation& s = speculative_[next];
+                s.at = now;
+                std::vector<std::string> symbols;
+                auto node = model_.find(next);
+                if (node != model_.end()) {
+                    symbols = node->second.symbols;
+                }
+                tasks_.push_back([this, next, symbols = std::move(symbols)] { preload(next, symbols); });
+                ++queued;
+            }
+            if (queued) {
+                wake_.notify_one();
+            }
+        }
+
+        /** Worker: load and pre-resolve one predicted library */
+        inline void preload(const std::string& path, const std::vector<std::string>& symbols) {
+            const size_t bytes = fileSize(path);
+            std::unique_ptr<SharedLibraryBase> lib = makeSharedLibrary(path);
+            {
+                std::lock_guard<std::mutex> g(lock_);
+                auto it = speculative_.find(path);
+                if (it == speculative_.end()) {
+                    return;                     // Overtaken by a real load before it started
+                }
+                if (heldBytes_ + bytes > options_.memoryBudget) {
+                    ++stats_.skippedBudget;
+                    speculative_.erase(it);
+                    return;
+                }
+                heldBytes_ += bytes;
+                it->second.bytes = bytes;
+                ours_.insert(lib.get());
+            }
+            const auto t0 = Clock::now();
+            bool ok = true;
+            try {
+                lib->loadNow();
+                for (const std::string& sym : symbols) {
+                    lib->tryGet<void*>(sym.c_str());
+                }
+            } catch (...) {
+                ok = false;
+            }
+            const uint64_t cost = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+            std::lock_guard<std::mutex> g(lock_);
+            cpuSpentNs_ += cost;
+            auto it = speculative_.find(path);
+            if (it == speculative_.end()) {
+                ours_.erase(lib.get());
+                graveyard_.push_back(std::move(lib));
+                return;
+            }
+            if (!ok) {
+                ++stats_.wasted;
+                stats_.wastedNs += cost;
+                heldBytes_ -= it->second.bytes;
+                speculative_.erase(it);
+                ours_.erase(lib.get());
+                graveyard_.push_back(std::move(lib));
+                return;
+            }
+            ++stats_.speculated;
+            it->second.lib = std::move(lib);
+            it->second.costNs = cost;
+            it->second.at = Clock::now();
+        }
+
+        /** Drop expired speculation as waste (lock held) */
+        inline void expire(Clock::time_point now) {
+            for (auto it = speculative_.begin(); it != speculative_.end();) {
+                if (it->second.lib && now - it->second.at > options_.expiry) {
+                    ++stats_.wasted;
+                    stats_.wastedNs += it->second.costNs;
+                    it = retire(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        /** Hand a finished speculation to the worker for release (lock held) */
+        inline std::map<std::string, Speculation>::iterator retire(std::map<std::string, Speculation>::iterator it) {
+            heldBytes_ -= it->second.bytes;
+            ours_.erase(it->second.lib.get());
+            graveyard_.push_back(std::move(it->second.lib));
+            wake_.notify_one();
+            return speculative_.erase(it);
+        }
+
+        inline bool loadedAnywhere(const std::string& path) const {
+            for (const auto& e : detail::LibraryRegistry::instance().snapshot()) {
+                if (e.path == path) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static inline size_t fileSize(const std::string& path) noexcept {
+#if defined(_WIN32)
+            WIN32_FILE_ATTRIBUTE_DATA data;
+            if (!::GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) {
+                return 0;
+            }
+            return static_cast<size_t>((uint64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+#else
+            struct stat st;
+            return ::stat(path.c_str(), &st) == 0 && st.st_size > 0 ? static_cast<size_t>(st.st_size) : 0;
+#endif
+        }
+
+        inline void loadModel() {
+            FILE* f = std::fopen(options_.modelPath.c_str(), "r");
+            if (!f) {
+                return;
+            }
+            char line[8192];
+            while (std::fgets(line, sizeof(line), f)) {
+                std::string l(line);
+                while (!l.empty() && (l.back() == '\n' || l.back() == '\r')) {
+                    l.pop_back();
+                }
+                std::vector<std::string> cols;
+                size_t pos = 0, tab;
+                while ((tab = l.find('\t', pos)) != std::string::npos) {
+                    cols.push_back(l.substr(pos, tab - pos));
+                    pos = tab + 1;
+                }
+                cols.push_back(l.substr(pos));
+                if (cols.size() == 4 && cols[0] == "T") {
+                    const uint64_t n = std::strtoull(cols[3].c_str(), nullptr, 10);
+                    Node& node = model_[cols[1]];
+                    node.next[cols[2]] += n;
+                    node.total += n;
+                } else if (cols.size() == 3 && cols[0] == "S") {
+                    model_[cols[1]].symbols.push_back(cols[2]);
+                }
+            }
+            std::fclose(f);
+        }
+
+        inline void work() {
+#if !defined(_WIN32)
+            ::setpriority(PRIO_PROCESS, 0, 19);     // Per-thread on Linux
+#endif
+            std::unique_lock<std::mutex> lk(lock_);
+            for (;;) {
+                wake_.wait_for(lk, std::chrono::seconds(1), [this] {
+                    return stopping_ || !tasks_.empty() || !graveyard_.empty();
+                });
+                if (!graveyard_.empty()) {
+                    auto dead = std::move(graveyard_);
+                    graveyard_.clear();
+                    lk.unlock();
+                    dead.clear();               // dlclose off the caller's thread
+                    lk.lock();
+                }
+                if (stopping_) {
+                    break;
+                }
+                if (!tasks_.empty()) {
+                    auto task = std::move(tasks_.front());
+                    tasks_.pop_front();
+                    lk.unlock();
+                    task();
+                    lk.lock();
+                }
+                expire(Clock::now());
+            }
+            std::vector<std::unique_ptr<SharedLibraryBase>> dead = std::move(graveyard_);
+            for (auto& s : speculative_) {
+                if (s.second.lib) {
+                    dead.push_back(std::move(s.second.lib));
+                }
+            }
+            speculative_.clear();
+            ours_.clear();
+            lk.unlock();
+            dead.clear();
+        }
+
+        PredictorOptions options_;
+        mutable std::mutex lock_;
+        std::condition_variable wake_;
+        std::map<std::string, Node> model_;
+        std::map<std::string, Speculation> speculative_;
+        std::vector<std::unique_ptr<SharedLibraryBase>> graveyard_;    // Released on the worker
+        std::deque<std::function<void()>> tasks_;
+        std::set<const SharedLibraryBase*> ours_;                        // Our own objects, not observed
+        std::string last_;
+        Clock::time_point lastAt_;
+        Clock::time_point cpuWindow_;
+        uint64_t cpuSpentNs_ = 0;
+        size_t heldBytes_ = 0;
+        PredictorStats stats_;
+        bool stopping_ = false;
+        std::thread worker_;
+    };
+
+    /*--------------------------------------------------------------
+     *  Work-stealing thread pool
+     *  Tasks: per-worker deques, owner pops LIFO, thieves take FIFO.
+     *  parallelFor: every participant (workers + caller) owns one
+     *  contiguous block of chunks, claims from its front and steals
+     *  single chunks from the back of other blocks.
+     *--------------------------------------------------------------*/
+    class WorkStealingPool {
+    public:
+        /** workers == 0: one per hardware thread */
+        explicit WorkStealingPool(unsigned workers = 0) {
+            if (!workers) {
+                workers = std::max(1u, std::thread::hardware_concurrency());
+            }
+            for (unsigned i = 0; i < workers; ++i) {
+                queues_.push_back(std::make_unique<Queue>());
+            }
+            threads_.reserve(workers);
+            try {
+                for (unsigned i = 0; i < workers; ++i) {
+                    threads_.emplace_back([this, i] { work(i); });
+                }
+            } catch (...) {
+                shutdown();     // Joinable threads must not be destroyed: stop the ones already started
+                throw;
+            }
+        }
+
+        ~WorkStealingPool() {
+            shutdown();
+        }
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        /** Process-wide pool */
+        static inline WorkStealingPool& shared() {
+            static WorkStealingPool pool;
+            return pool;
+        }
+
+        inline unsigned size() const noexcept {
+            return static_cast<unsigned>(threads_.size());
+        }
+
+        /** Index of the calling worker of this pool, or -1 */
+        inline int currentWorker() const noexcept {
+            return current().pool == this ? current().index : -1;
+        }
+
+        /** Queue a task, on a given worker's deque when preferred >= 0 */
+        inline void post(std::function<void()> task, int preferred = -1) {
+            unsigned target;
+            if (preferred >= 0) {
+                target = static_cast<unsigned>(preferred) % size();
+            } else if (currentWorker() >= 0) {
+                target = static_cast<unsigned>(currentWorker());
+            } else {
+                target = static_cast<unsigned>(next_.fetch_add(1, std::memory_order_relaxed)) % size();
+            }
+            {
+                std::lock_guard<std::mutex> g(queues_[target]->lock);
+                queues_[target]->tasks.push_back(std::move(task));
+            }
+            pending_.fetch_add(1);
+            {
+                std::lock_guard<std::mutex> g(sleepLock_);
+            }
+            wake_.notify_one();
+        }
+
+        /** Queue fn() and get its result */
+        template<class _Fn>
+        inline auto submit(_Fn&& fn) -> std::future<std::invoke_result_t<_Fn&>> {
+            using R = std::invoke_result_t<_Fn&>;
+            auto task = std::make_shared<std::packaged_task<R()>>(std::forward<_Fn>(fn));
+            std::future<R> f = task->get_future();
+            post([task] { (*task)(); });
+            return f;
+        }
+
+        /** fn(chunk) for chunk in [0, chunks); the caller takes part, exceptions are rethrown */
+        template<class _Fn>
+        inline void parallelFor(size_t chunks, _Fn&& fn) {
+            if (chunks == 0) {
+                return;
+            }
+            const unsigned parts = size() + 1;
+            if (chunks == 1 || chunks >= (size_t(1) << 32)) {
+                for (size_t c = 0; c < chunks; ++c) {
+                    fn(c);
+                }
+                return;
+            }
+            auto job = std::make_shared<ForJob>(parts, chunks);
+            std::function<void(size_t)> body = [&fn](size_t c) { fn(c); };
+            job->body = &body;
+            for (unsigned w = 0; w < size(); ++w) {
+                post([job, w] { job->participate(w); }, static_cast<int>(w));
+            }
+            job->participate(parts - 1);
+            std::unique_lock<std::mutex> lk(job->lock);
+            job->done.wait(lk, [&] { return job->remaining.load() == 0; });
+            job->body = nullptr;
+            if (job->error) {
+                std::rethrow_exception(job->error);
+            }
+        }
+
+    private:
+        struct alignas(64) Queue {
+            std::mutex lock;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        struct WorkerId {
+            const WorkStealingPool* pool = nullptr;
+            int index = -1;
+        };
+
+        static inline WorkerId& current() noexcept {
+            thread_local WorkerId id;
+            return id;
+        }
+
+        struct alignas(64) Range {
+            std::atomic<uint64_t> bounds{ 0 };          // begin | end << 32
+
+            inline bool claimFront(size_t& c) noexcept {
+                uint64_t b = bounds.load(std::memory_order_relaxed);
+                while (static_cast<uint32_t>(b) < static_cast<uint32_t>(b >> 32)) {
+                    if (bounds.compare_exchange_weak(b, b + 1, std::memory_order_acq_rel)) {
+                        c = static_cast<uint32_t>(b);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            inline bool claimBack(size_t& c) noexcept {
+                uint64_t b = bounds.load(std::memory_order_relaxed);
+                while (static_cast<uint32_t>(b) < static_cast<uint32_t>(b >> 32)) {
+                    if (bounds.compare_exchange_weak(b, b - (uint64_t(1) << 32), std::memory_order_acq_rel)) {
+                        c = static_cast<uint32_t>(b >> 32) - 1;
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+
+        struct ForJob {
+            ForJob(unsigned parts, size_t chunks) : ranges(parts), remaining(chunks) {
+                for (unsigned p = 0; p < parts; ++p) {
+                    const uint64_t begin = chunks * p / parts, end = chunks * (p + 1) / parts;
+                    ranges[p].bounds.store(begin | (end << 32), std::memory_order_relaxed);
+                }
+            }
+
+            inline void participate(unsigned self) {
+                size_t c;
+                while (ranges[self].claimFront(c)) {
+                    run(c);
+                }
+                for (size_t i = 1; i < ranges.size(); ++i) {
+                    Range& victim = ranges[(self + i) % ranges.size()];
+                    while (victim.claimBack(c)) {
+                        run(c);
+                    }
+                }
+            }
+
+            inline void run(size_t c) {
+                if (!failed.load(std::memory_order_relaxed)) {
+                    try {
+                        (*body)(c);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> g(lock);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                        failed.store(true, std::memory_order_relaxed);
+                    }
+                }
+                if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    std::lock_guard<std::mutex> g(lock);
+                    done.notify_all();
+                }
+            }
+
+            std::vector<Range> ranges;
+            std::atomic<size_t> remaining;
+            std::atomic<bool> failed{ false };
+            std::function<void(size_t)>* body = nullptr;   // Caller's stack; only touched while chunks remain
+            std::exception_ptr error;
+            std::mutex lock;
+            std::condition_variable done;
+        };
+
+        inline bool take(unsigned self, std::function<void()>& task) {
+            {
+                Queue& q = *queues_[self];
+                std::lock_guard<std::mutex> g(q.lock);
+                if (!q.tasks.empty()) {
+                    task = std::move(q.tasks.back());
+                    q.tasks.pop_back();
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < queues_.size(); ++i) {
+                Queue& q = *queues_[(self + i) % queues_.size()];
+                std::lock_guard<std::mutex> g(q.lock);
+                if (!q.tasks.empty()) {
+                    task = std::move(q.tasks.front());
+                    q.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        inline void shutdown() noexcept {
+            {
+                std::lock_guard<std::mutex> g(sleepLock_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for (auto& t : threads_) {
+                t.join();
+            }
+        }
+
+        inline void work(unsigned self) {
+            current() = WorkerId{ this, static_cast<int>(self) };
+            std::function<void()> task;
+            for (;;) {
+                if (take(self, task)) {
+                    pending_.fetch_sub(1);
+                    task();
+                    task = nullptr;
+                    continue;
+                }
+                std::unique_lock<std::mutex> lk(sleepLock_);
+                wake_.wait(lk, [this] { return stop_ || pending_.load() > 0; });
+                if (stop_ && pending_.load() == 0) {
+                    return;
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> threads_;
+        std::atomic<size_t> pending_{ 0 };      // Queued, not yet taken
+        std::atomic<unsigned> next_{ 0 };       // Round-robin target for external posts
+        std::mutex sleepLock_;
+        std::condition_variable wake_;
+        bool stop_ = false;
+    };
+
+    namespace detail {
+
+    /** Per-core L2 size in bytes (sysconf, then sysfs, then 256 KiB) */
+    inline size_t l2CacheBytes() noexcept {
+        static const size_t bytes = [] {
+            long v = 0;
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+            v = ::sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+            if (v <= 0) {
+                if (FILE* f = std::fopen("/sys/devices/system/cpu/cpu0/cache/index2/size", "r")) {
+                    char unit = 0;
+                    if (std::fscanf(f, "%ld%c", &v, &unit) >= 1 && (unit == 'K' || unit == 'k')) {
+                        v *= 1024;
+                    } else if (unit == 'M' || unit == 'm') {
+                        v *= 1024 * 1024;
+                    }
+                    std::fclose(f);
+                }
+            }
+            return v > 0 ? static_cast<size_t>(v) : size_t(256) * 1024;
+        }();
+        return bytes;
+    }
+
+    /** Elements per chunk: in+out of a chunk fill half of L2, with several chunks per participant */
+    inline size_t mapChunk(size_t n, size_t bytesPerItem, size_t outSize, unsigned parts) noexcept {
+        size_t chunk = std::max<size_t>(1, (l2CacheBytes() / 2) / std::max<size_t>(1, bytesPerItem));
+        chunk = std::min(chunk, std::max<size_t>(1, (n + parts * 4 - 1) / (parts * 4)));
+        chunk = std::max<size_t>(chunk, 256);
+        const size_t line = std::max<size_t>(1, 64 / std::max<size_t>(1, outSize));
+        return (chunk + line - 1) / line * line;        // Chunk edges on cache-line boundaries of the output
+    }
+
+    template<class _T, class = void>
+    struct Resizable : std::false_type {};
+    template<class _T>
+    struct Resizable<_T, std::void_t<decltype(std::declval<_T&>().resize(size_t()))>> : std::true_type {};
+
+    }   // namespace detail
+
+    /*--------------------------------------------------------------
+     *  Parallel map over element-wise exports
+     *--------------------------------------------------------------*/
+
+    /** out[i] = fn(in[i]) on the pool. Each participant starts on its own contiguous block, so
+     *  untouched output pages are first touched (and placed) by the thread that fills them. */
+    template<class _Func, class _In, class _Out>
+    inline void parallelMap(_Func fn, const _In* in, size_t n, _Out* out, WorkStealingPool& pool = WorkStealingPool::shared()) {
+        const size_t chunk = detail::mapChunk(n, sizeof(_In) + sizeof(_Out), sizeof(_Out), pool.size() + 1);
+        pool.parallelFor((n + chunk - 1) / chunk, [&](size_t c) {
+            const size_t end = std::min(n, (c + 1) * chunk);
+            for (size_t i = c * chunk; i < end; ++i) {
+                out[i] = fn(in[i]);
+            }
+        });
+    }
+
+    /** Container form, e.g. parallelMap(lib->get<double(*)(double)>("f"), input, output) */
+    template<class _Func, class _InRange, class _OutRange>
+    inline void parallelMap(_Func fn, const _InRange& input, _OutRange& output, WorkStealingPool& pool = WorkStealingPool::shared()) {
+        const size_t n = std::size(input);
+        if (std::size(output) < n) {
+            if constexpr (detail::Resizable<_OutRange>::value) {
+                output.resize(n);
+            } else {
+                throw std::invalid_argument("parallelMap: output smaller than input");
+            }
+        }
+        parallelMap(fn, std::data(input), n, std::data(output), pool);
+    }
+
+    /** Fresh output buffer left untouched until the workers write it (first touch for trivial types) */
+    template<class _Func, class _In>
+    inline auto parallelMap(_Func fn, const _In* in, size_t n, WorkStealingPool& pool = WorkStealingPool::shared()) {
+        using Out = std::decay_t<std::invoke_result_t<_Func&, const _In&>>;
+        std::unique_ptr<Out[]> out(new Out[n]);
+        parallelMap(fn, in, n, out.get(), pool);
+        return out;
+    }
+
+    /** Unordered results: sink(index, fn(in[index])) is called from the workers as chunks finish */
+    template<class _Func, class _In, class _Sink>
+    inline void parallelMapUnordered(_Func fn, const _In* in, size_t n, _Sink&& sink, WorkStealingPool& pool = WorkStealingPool::shared()) {
+        using Out = std::decay_t<std::invoke_result_t<_Func&, const _In&>>;
+        const size_t chunk = detail::mapChunk(n, sizeof(_In) + sizeof(Out), sizeof(Out), pool.size() + 1);
+        pool.parallelFor((n + chunk - 1) / chunk, [&](size_t c) {
+            const size_t end = std::min(n, (c + 1) * chunk);
+            for (size_t i = c * chunk; i < end; ++i) {
+                sink(i, fn(in[i]));
+            }
+        });
+    }
+
+    /*--------------------------------------------------------------
+     *  Hook broadcast
+     *  The hook is resolved once per library (absent ones cached as
+     *  null), then each invoke() runs the stages in ascending order,
+     *  every stage's hooks in parallel on the pool.
+     *--------------------------------------------------------------*/
+    enum class HookStatus {
+        Ok,         // Ran before the deadline
+        Absent,     // Library does not export the hook
+        Skipped,    // Deadline passed before it started
+        Late,       // Started in time, finished after the deadline
+        Failed      // Threw; see error
+    };
+
+    struct HookUnit {};
+
+    template<class _R>
+    struct HookResult {
+        SharedLibraryBase* library = nullptr;
+        HookStatus status = HookStatus::Absent;
+        std::conditional_t<std::is_void_v<_R>, HookUnit, _R> value{};
+        uint64_t ns = 0;            // Wall time of the call
+        std::string error;
+    };
+
+    template<class _Func>
+    class HookBroadcast;
+
+    template<class _R, class... _Args>
+    class HookBroadcast<_R(*)(_Args...)> {
+    public:
+        using Func = _R(*)(_Args...);
+        using Result = HookResult<_R>;
+
+        /** All libraries in stage 0 */
+        HookBroadcast(const std::vector<SharedLibraryBase*>& libraries, const char* name,
+                      WorkStealingPool& pool = WorkStealingPool::shared())
+            : pool_(pool) {
+            for (SharedLibraryBase* lib : libraries) {
+                add(*lib, name, 0);
+            }
+        }
+
+        /** (library, stage) pairs; lower stages finish before higher ones start */
+        HookBroadcast(const std::vector<std::pair<SharedLibraryBase*, int>>& libraries, const char* name,
+                      WorkStealingPool& pool = WorkStealingPool::shared())
+            : pool_(pool) {
+            for (const auto& entry : libraries) {
+                add(*entry.first, name, entry.second);
+            }
+        }
+
+        /** Number of libraries that export the hook */
+        inline size_t resolved() const noexcept {
+            size_t n = 0;
+            for (const Target& t : targets_) {
+                n += t.fn != nullptr;
+            }
+            return n;
+        }
+
+        /** Call every hook; results follow construction order */
+        inline std::vector<Result> invoke(_Args... args) {
+            return invokeUntil(std::chrono::steady_clock::time_point::max(), args...);
+        }
+
+        /** Hooks not started within the budget are Skipped; a running hook is never interrupted */
+        template<class _Rep, class _Period>
+        inline std::vector<Result> invokeFor(std::chrono::duration<_Rep, _Period> budget, _Args... args) {
+            return invokeUntil(std::chrono::steady_clock::now() +
+                               std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget), args...);
+        }
+
+        inline std::vector<Result> invokeUntil(std::chrono::steady_clock::time_point deadline, _Args... args) {
+            std::vector<Result> results(targets_.size());
+            for (size_t i = 0; i < targets_.size(); ++i) {
+                results[i].library = targets_[i].library;
+            }
+            for (size_t s = 0; s + 1 < stages_.size(); ++s) {
+                const size_t begin = stages_[s], end = stages_[s + 1];
+                pool_.parallelFor(end - begin, [&](size_t k) {
+                    const size_t i = order_[begin + k];
+                    run(targets_[i].fn, results[i], deadline, args...);
+                });
+            }
+            return results;
+        }
+
+    private:
+        struct Target {
+            SharedLibraryBase* library;
+            Func fn;
+            int stage;
+        };
+
+        inline void add(SharedLibraryBase& lib, const char* name, int stage) {
+            targets_.push_back(Target{ &lib, lib.tryGet<Func>(name), stage });
+            // Rebuild stage order: present hooks only, stable by stage
+            order_.clear();
+            for (size_t i = 0; i < targets_.size(); ++i) {
+                if (targets_[i].fn) {
+                    order_.push_back(i);
+                }
+            }
+            std::stable_sort(order_.begin(), order_.end(), [this](size_t a, size_t b) {
+                return targets_[a].stage < targets_[b].stage;
+            });
+            stages_.assign(1, 0);
+            for (size_t k = 1; k <= order_.size(); ++k) {
+                if (k == order_.size() || targets_[order_[k]].stage != targets_[order_[k - 1]].stage) {
+                    stages_.push_back(k);
+                }
+            }
+            if (order_.empty()) {
+                stages_.clear();
+            }
+        }
+
+        static inline void run(Func fn, Result& r, std::chrono::steady_clock::time_point deadline, _Args... args) {
+            const auto start = std::chrono::steady_clock::now();
+            if (start >= deadline) {
+                r.status = HookStatus::Skipped;
+                return;
+            }
+            try {
+                if constexpr (std::is_void_v<_R>) {
+                    fn(args...);
+                } else {
+                    r.value = fn(args...);
+                }
+                r.status = HookStatus::Ok;
+            } catch (const std::exception& e) {
+                r.status = HookStatus::Failed;
+                r.error = e.what();
+            } catch (...) {
+                r.status = HookStatus::Failed;
+                r.error = "unknown exception";
+            }
+            const auto finish = std::chrono::steady_clock::now();
+            r.ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count());
+            if (r.status == HookStatus::Ok && finish > deadline) {
+                r.status = HookStatus::Late;
+            }
+        }
+
+        WorkStealingPool& pool_;
+        std::vector<Target> targets_;   // Construction order
+        std::vector<size_t> order_;     // Present hooks sorted by stage
+        std::vector<size_t> stages_;    // Stage boundaries into order_
+    };
+
+    /** One-shot broadcast; build a HookBroadcast to reuse the resolution */
+    template<class _Func, class... _Args>
+    inline auto broadcast(const std::vector<SharedLibraryBase*>& libraries, const char* name, _Args&&... args) {
+        return HookBroadcast<_Func>(libraries, name).invoke(std::forward<_Args>(args)...);
+    }
+
+    /*--------------------------------------------------------------
+     *  Batch-ABI adaptation
+     *  A scalar export Out name(In) may have a batch twin
+     *  void twin(const In*, Out*, size_t). The twin is found through
+     *  the library's sharedlibrary_batch_variants table, when it
+     *  exports one, and otherwise as <name>_batch.
+     *--------------------------------------------------------------*/
+
+    /** Entry of the optional `sharedlibrary_batch_variants` export, terminated by {nullptr, nullptr} */
+    struct BatchVariant {
+        const char* scalar;
+        const char* batch;
+    };
+
+    namespace detail {
+
+    /** Name of the batch twin of `name`, via metadata table first, then the _batch suffix */
+    inline void* findBatchVariant(SharedLibraryBase& lib, const char* name) {
+        if (auto* table = lib.tryGet<const BatchVariant*>("sharedlibrary_batch_variants")) {
+            for (const BatchVariant* v = table; v->scalar; ++v) {
+                if (std::strcmp(v->scalar, name) == 0) {
+                    return v->batch ? lib.tryGet<void*>(v->batch) : nullptr;
+                }
+            }
+        }
+        return lib.tryGet<void*>((std::string(name) + "_batch").c_str());
+    }
+
+    }   // namespace detail
+
+    template<class _Func>
+    class BatchCall;
+
+    /** Batch entry point for a scalar export: the twin when exported, else a loop over the scalar */
+    template<class _Out, class _In>
+    class BatchCall<_Out(*)(_In)> {
+    public:
+        using In = std::decay_t<_In>;
+        using Batch = void(*)(const In*, _Out*, size_t);
+        using Scalar = _Out(*)(_In);
+
+        BatchCall(SharedLibraryBase& lib, const char* name)
+            : batch_(reinterpret_cast<Batch>(detail::findBatchVariant(lib, name))),
+              scalar_(batch_ ? nullptr : lib.get<Scalar>(name)) {}
+
+        /** out[i] = name(in[i]) */
+        inline void operator()(const In* in, _Out* out, size_t n) const {
+            if (batch_) {
+                batch_(in, out, n);
+            } else {
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = scalar_(in[i]);
+                }
+            }
+        }
+
+        /** True when calls go to the batch twin */
+        inline bool batched() const noexcept {
+            return batch_ != nullptr;
+        }
+
+    private:
+        Batch batch_;
+        Scalar scalar_;
+    };
+
+    /** Coalesces scalar call sites: push(x, &y) queues, y is written when the buffer flushes */
+    template<class _Func>
+    class Coalescer;
+
+    template<class _Out, class _In>
+    class Coalescer<_Out(*)(_In)> {
+    public:
+        using In = std::decay_t<_In>;
+
+        /** capacity == 0: as many calls as fit in half of L2 */
+        Coalescer(SharedLibraryBase& lib, const char* name, size_t capacity = 0)
+            : call_(lib, name),
+              capacity_(capacity ? capacity : std::max<size_t>(16, detail::l2CacheBytes() / 2 / (sizeof(In) + 2 * sizeof(_Out) + sizeof(_Out*)))) {
+            in_.reserve(capacity_);
+            dest_.reserve(capacity_);
+        }
+
+        ~Coalescer() {
+            try {
+                flush();
+            } catch (...) {
+            }
+        }
+
+        Coalescer(const Coalescer&) = delete;
+        Coalescer& operator=(const Coalescer&) = delete;
+
+        /** Queue name(x) with its result going to *dest; flushes when full */
+        inline void push(const In& x, _Out* dest) {
+            in_.push_back(x);
+            dest_.push_back(dest);
+            if (in_.size() == capacity_) {
+                flush();
+            }
+        }
+
+        /** Run all queued calls and scatter the results */
+        inline void flush() {
+            const size_t n = in_.size();
+            if (!n) {
+                return;
+            }
+            out_.resize(n);
+            call_(in_.data(), out_.data(), n);
+            for (size_t i = 0; i < n; ++i) {
+                *dest_[i] = out_[i];
+            }
+            in_.clear();
+            dest_.clear();
+            ++flushes_;
+        }
+
+        inline size_t pending() const noexcept { return in_.size(); }
+        inline size_t capacity() const noexcept { return capacity_; }
+        inline uint64_t flushes() const noexcept { return flushes_; }
+        inline bool batched() const noexcept { return call_.batched(); }
+
+    private:
+        BatchCall<_Out(*)(_In)> call_;
+        size_t capacity_;
+        std::vector<In> in_;
+        std::vector<_Out*> dest_;
+        std::vector<_Out> out_;
+        uint64_t flushes_ = 0;
+    };
+
+    /*--------------------------------------------------------------
+     *  Fused stage pipelines
+     *  Records move in cache-sized batches. Each stage is a
+     *  BatchCall, so batch twins are used when exported. Threaded
+     *  runs give every stage its own thread, linked by bounded SPSC
+     *  rings of batch buffers that stages fill in place.
+     *--------------------------------------------------------------*/
+    struct PipelineOptions {
+        size_t batch = 0;           // Records per batch; 0: sized from L2
+        size_t depth = 4;           // Batch buffers between two stages
+        bool threaded = true;       // One thread per stage; false runs every batch through all stages inline
+    };
+
+    struct StageStats {
+        std::string name;
+        bool batched = false;       // Bound to the <name>_batch entry point
+        uint64_t records = 0;
+        uint64_t batches = 0;
+        uint64_t busyNs = 0;        // Time inside the stage
+        double recordsPerSec = 0;   // records / busy time
+    };
+
+    namespace detail {
+
+    /** Batch buffers are reinterpreted as any stage's records: one alignment covers them all */
+    constexpr size_t kRecordAlign = 64;
+
+    struct RecordBufferDelete {
+        void operator()(unsigned char* p) const noexcept {
+            ::operator delete(p, std::align_val_t(kRecordAlign));
+        }
+    };
+
+    using RecordBuffer = std::unique_ptr<unsigned char[], RecordBufferDelete>;
+
+    inline RecordBuffer makeRecordBuffer(size_t bytes) {
+        return RecordBuffer(static_cast<unsigned char*>(::operator new(std::max<size_t>(1, bytes), std::align_val_t(kRecordAlign))));
+    }
+
+    struct PipelineStage {
+        std::string name;
+        size_t inSize = 0, outSize = 0;
+        bool batched = false;
+        std::function<void(const void*, void*, size_t)> fn;
+        uint64_t records = 0, batches = 0, busyNs = 0;      // Only the stage's own thread writes during a run
+
+        inline void apply(const void* in, void* out, size_t n) {
+            const auto t0 = std::chrono::steady_clock::now();
+            fn(in, out, n);
+            busyNs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0).count());
+            records += n;
+            ++batches;
+        }
+    };
+
+    /** Bounded single-producer/single-consumer ring of batch buffers */
+    class BatchRing {
+    public:
+        struct Slot {
+            RecordBuffer data;
+            size_t count = 0;
+        };
+
+        BatchRing(size_t depth, size_t bytes) : slots_(std::max<size_t>(2, depth)) {
+            for (Slot& s : slots_) {
+                s.data = makeRecordBuffer(bytes);
+            }
+        }
+
+        /** Producer: next free slot, nullptr on abort */
+        inline Slot* acquireWrite(const std::atomic<bool>& abort) {
+            const size_t t = tail_.load(std::memory_order_relaxed);
+            for (unsigned spin = 0; t - head_.load(std::memory_order_acquire) >= slots_.size(); ++spin) {
+                if (abort.load(std::memory_order_relaxed)) {
+                    return nullptr;
+                }
+                backoff(spin);
+            }
+            return &slots_[t % slots_.size()];
+        }
+
+        inline void publish() {
+            tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        inline void close() {
+            closed_.store(true, std::memory_order_release);
+        }
+
+        /** Consumer: next filled slot, nullptr once closed and drained or on abort */
+        inline Slot* acquireRead(const std::atomic<bool>& abort) {
+            const size_t h = head_.load(std::memory_order_relaxed);
+            for (unsigned spin = 0; tail_.load(std::memory_order_acquire) == h; ++spin) {
+                if (abort.load(std::memory_order_relaxed)) {
+                    return nullptr;
+                }
+                if (closed_.load(std::memory_order_acquire) && tail_.load(std::memory_order_acquire) == h) {
+                    return nullptr;
+                }
+                backoff(spin);
+            }
+            return &slots_[h % slots_.size()];
+        }
+
+        inline void release() {
+            head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+    private:
+        static inline void backoff(unsigned spin) {
+            if (spin < 64) {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+                _mm_pause();
+#endif
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        std::vector<Slot> slots_;
+        alignas(64) std::atomic<size_t> head_{ 0 };
+        alignas(64) std::atomic<size_t> tail_{ 0 };
+        alignas(64) std::atomic<bool> closed_{ false };
+    };
+
+    }   // namespace detail
+
+    template<class _In, class _Out = _In>
+    class Pipeline {
+        static_assert(std::is_trivially_copyable_v<_In> && std::is_trivially_copyable_v<_Out>,
+                      "Pipeline records must be trivially copyable");
+        static_assert(alignof(_In) <= detail::kRecordAlign && alignof(_Out) <= detail::kRecordAlign,
+                      "Pipeline records must not be over-aligned beyond detail::kRecordAlign");
+    public:
+        explicit Pipeline(PipelineOptions options = {}) : options_(options) {
+            static_assert(std::is_same_v<_In, _Out>, "Start a pipeline as Pipeline<Record>()");
+        }
+
+        /** Append lib's `name` stage mapping _Out -> _Next */
+        template<class _Next>
+        inline Pipeline<_In, _Next> stage(SharedLibraryBase& lib, const char* name) && {
+            static_assert(std::is_trivially_copyable_v<_Next>, "Pipeline records must be trivially copyable");
+            static_assert(alignof(_Next) <= detail::kRecordAlign, "Pipeline records must not be over-aligned beyond detail::kRecordAlign");
+            auto s = std::make_unique<detail::PipelineStage>();
+            s->name = name;
+            s->inSize = sizeof(_Out);
+            s->outSize = sizeof(_Next);
+            BatchCall<_Next(*)(_Out)> call(lib, name);
+            s->batched = call.batched();
+            s->fn = [call](const void* in, void* out, size_t n) {
+                call(static_cast<const _Out*>(in), static_cast<_Next*>(out), n);
+            };
+            Pipeline<_In, _Next> next(std::move(stages_), options_);
+            next.stages_.push_back(std::move(s));
+            return next;
+        }
+
+        /** out[i] = stages(in[i]) */
+        inline void run(const _In* in, size_t n, _Out* out) {
+            if (stages_.empty()) {
+                if constexpr (std::is_same_v<_In, _Out>) {
+                    std::copy(in, in + n, out);
+                }
+                return;
+            }
+            if (n == 0) {
+                return;
+            }
+            const size_t batch = batchSize();
+            if (options_.threaded && stages_.size() > 1 && n > batch) {
+                runThreaded(reinterpret_cast<const unsigned char*>(in), n, reinterpret_cast<unsigned char*>(out), batch);
+            } else {
+                runFused(reinterpret_cast<const unsigned char*>(in), n, reinterpret_cast<unsigned char*>(out), batch);
+            }
+        }
+
+        inline std::vector<_Out> run(const std::vector<_In>& in) {
+            std::vector<_Out> out(in.size());
+            run(in.data(), in.size(), out.data());
+            return out;
+        }
+
+        /** Per-stage counters, accumulated over runs */
+        inline std::vector<StageStats> stats() const {
+            std::vector<StageStats> result;
+            for (const auto& s : stages_) {
+                StageStats st;
+                st.name = s->name;
+                st.batched = s->batched;
+                st.records = s->records;
+                st.batches = s->batches;
+                st.busyNs = s->busyNs;
+                st.recordsPerSec = s->busyNs ? s->records * 1e9 / s->busyNs : 0.0;
+                result.push_back(std::move(st));
+            }
+            return result;
+        }
+
+        inline void resetStats() noexcept {
+            for (auto& s : stages_) {
+                s->records = s->batches = s->busyNs = 0;
+            }
+        }
+
+        /** Records per batch: the widest stage's input and output fill half of L2 */
+        inline size_t batchSize() const noexcept {
+            if (options_.batch) {
+                return options_.batch;
+            }
+            size_t widest = 1;
+            for (const auto& s : stages_) {
+                widest = std::max(widest, s->inSize + s->outSize);
+            }
+            return std::max<size_t>(64, detail::l2CacheBytes() / 2 / widest);
+        }
+
+    private:
+        template<class, class> friend class Pipeline;
+
+        Pipeline(std::vector<std::unique_ptr<detail::PipelineStage>>&& stages, PipelineOptions options)
+            : options_(options), stages_(std::move(stages)) {}
+
+        inline void runFused(const unsigned char* in, size_t n, unsigned char* out, size_t batch) {
+            size_t widest = 0;
+            for (const auto& s : stages_) {
+                widest = std::max(widest, s->outSize);
+            }
+            detail::RecordBuffer ping = detail::makeRecordBuffer(batch * widest), pong = detail::makeRecordBuffer(batch * widest);
+            for (size_t off = 0; off < n; off += batch) {
+                const size_t count = std::min(batch, n - off);
+                const void* src = in + off * stages_.front()->inSize;
+                for (size_t i = 0; i < stages_.size(); ++i) {
+                    void* dst = i + 1 == stages_.size() ? out + off * sizeof(_Out) : (i % 2 ? pong.get() : ping.get());
+                    stages_[i]->apply(src, dst, count);
+                    src = dst;
+                }
+            }
+        }
+
+        inline void runThreaded(const unsigned char* in, size_t n, unsigned char* out, size_t batch) {
+            const size_t k = stages_.size();
+            std::vector<std::unique_ptr<detail::BatchRing>> rings;
+            for (size_t i = 0; i + 1 < k; ++i) {
+                rings.push_back(std::make_unique<detail::BatchRing>(options_.depth, batch * stages_[i]->outSize));
+            }
+            std::atomic<bool> abort{ false };
+            std::mutex errorLock;
+            std::exception_ptr error;
+            auto guarded = [&](auto&& body) {
+                try {
+                    body();
+                } catch (...) {
+                    std::lock_guard<std::mutex> g(errorLock);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    abort.store(true);
+                }
+            };
+
+            std::vector<std::thread> threads;
+            threads.reserve(k - 1);
+            try {
+                threads.emplace_back([&] {
+                    guarded([&] {
+                        for (size_t off = 0; off < n; off += batch) {
+                            detail::BatchRing::Slot* w = rings[0]->acquireWrite(abort);
+                            if (!w) {
+                                return;
+                            }
+                            w->count = std::min(batch, n - off);
+                            stages_[0]->apply(in + off * sizeof(_In), w->data.get(), w->count);
+                            rings[0]->publish();
+                        }
+                    });
+                    rings[0]->close();
+                });
+                for (size_t i = 1; i + 1 < k; ++i) {
+                    threads.emplace_back([&, i] {
+                        guarded([&] {
+                            while (detail::BatchRing::Slot* r = rings[i - 1]->acquireRead(abort)) {
+                                detail::BatchRing::Slot* w = rings[i]->acquireWrite(abort);
+                                if (!w) {
+                                    return;
+                                }
+                                w->count = r->count;
+                                stages_[i]->apply(r->data.get(), w->data.get(), r->count);
+                                rings[i - 1]->release();
+                                rings[i]->publish();
+                            }
+                        });
+                        rings[i]->close();
+                    });
+                }
+            } catch (...) {
+                // Started stages reference this frame: stop them at their next ring operation before unwinding
+                abort.store(true);
+                for (auto& t : threads) {
+                    t.join();
+                }
+                throw;
+            }
+            guarded([&] {
+                size_t off = 0;
+                while (detail::BatchRing::Slot* r = rings[k - 2]->acquireRead(abort)) {
+                    stages_[k - 1]->apply(r->data.get(), out + off * sizeof(_Out), r->count);
+                    off += r->count;
+                    rings[k - 2]->release();
+                }
+            });
+            for (auto& t : threads) {
+                t.join();
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        PipelineOptions options_;
+        std::vector<std::unique_ptr<detail::PipelineStage>> stages_;
+    };
+
+    /*--------------------------------------------------------------
+     *  SHA-256 (scalar, and SHA-NI when the CPU has it)
+     *--------------------------------------------------------------*/
+    using Sha256Digest = std::array<uint8_t, 32>;
+
+    namespace detail {
+
+    alignas(16) static constexpr uint32_t kSha256K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    inline void sha256Scalar(uint32_t state[8], const uint8_t* data, size_t blocks) noexcept {
+        auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+        for (; blocks; --blocks, data += 64) {
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i) {
+                w[i] = uint32_t(data[i * 4]) << 24 | uint32_t(data[i * 4 + 1]) << 16 |
+                       uint32_t(data[i * 4 + 2]) << 8 | uint32_t(data[i * 4 + 3]);
+            }
+            for (int i = 16; i < 64; ++i) {
+                const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; ++i) {
+                const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kSha256K[i] + w[i];
+                const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+    }
+
+#if defined(__x86_64__) || defined(_M_X64)
+#if !defined(_MSC_VER)
+    __attribute__((target("sha,sse4.1,ssse3")))
+#endif
+    inline void sha256Ni(uint32_t state[8], const uint8_t* data, size_t blocks) noexcept {
+        const __m128i swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);       // ABEF
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);            // CDGH
+
+        for (; blocks; --blocks, data += 64) {
+            const __m128i abef = state0, cdgh = state1;
+            __m128i w[4];
+            for (int g = 0; g < 16; ++g) {
+                __m128i& cur = w[g & 3];
+                if (g < 4) {
+                    cur = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + g * 16)), swap);
+                } else {
+                    const __m128i prev = w[(g - 1) & 3];
+                    cur = _mm_sha256msg1_epu32(cur, w[(g - 3) & 3]);
+                    cur = _mm_add_epi32(cur, _mm_alignr_epi8(prev, w[(g - 2) & 3], 4));
+                    cur = _mm_sha256msg2_epu32(cur, prev);
+                }
+                __m128i msg = _mm_add_epi32(cur, _mm_load_si128(reinterpret_cast<const __m128i*>(&kSha256K[g * 4])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                msg = _mm_shuffle_epi32(msg, 0x0E);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            }
+            state0 = _mm_add_epi32(state0, abef);
+            state1 = _mm_add_epi32(state1, cdgh);
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1B);                  // FEBA
+        state1 = _mm_shuffle_epi32(state1, 0xB1);               // DCHG
+        state0 = _mm_blend_epi16(tmp, state1, 0xF0);            // DCBA
+        state1 = _mm_alignr_epi8(state1, tmp, 8);               // HGFE
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+    }
+
+    inline bool cpuHasShaNi() noexcept {
+        static const bool has = [] {
+            unsigned a = 0, b = 0, c = 0, d = 0;
+#if defined(_MSC_VER)
+            int r[4];
+            __cpuid(r, 1);
+            c = unsigned(r[2]);
+            __cpuidex(r, 7, 0);
+            b = unsigned(r[1]);
+#else
+            if (!__get_cpuid(1, &a, &b, &c, &d)) {
+                return false;
+            }
+            const unsigned ecx1 = c;
+            if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+                return false;
+            }
+            c = ecx1;
+#endif
+            return (b & (1u << 29)) && (c & (1u << 19)) && (c & (1u << 9));     // SHA, SSE4.1, SSSE3
+        }();
+        return has;
+    }
+#endif
+
+    /** Compress whole 64-byte blocks with the fastest available kernel */
+    inline void sha256Blocks(uint32_t state[8], const uint8_t* data, size_t blocks) noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+        if (cpuHasShaNi()) {
+            sha256Ni(state, data, blocks);
+            return;
+        }
+#endif
+        sha256Scalar(state, data, blocks);
+    }
+
+    }   // namespace detail
+
+    /** SHA-256 of a buffer */
+    inline Sha256Digest sha256(const void* data, size_t size) noexcept {
+        uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        detail::sha256Blocks(state, p, size / 64);
+        uint8_t tail[128] = {};
+        const size_t rest = size % 64;
+        if (rest) {
+            std::memcpy(tail, p + size - rest, rest);
+        }
+        tail[rest] = 0x80;
+        const size_t tailBlocks = rest < 56 ? 1 : 2;
+        const uint64_t bits = uint64_t(size) * 8;
+        for (int i = 0; i < 8; ++i) {
+            tail[tailBlocks * 64 - 1 - i] = uint8_t(bits >> (i * 8));
+        }
+        detail::sha256Blocks(state, tail, tailBlocks);
+        Sha256Digest out;
+        for (int i = 0; i < 8; ++i) {
+            out[i * 4] = uint8_t(state[i] >> 24);
+            out[i * 4 + 1] = uint8_t(state[i] >> 16);
+            out[i * 4 + 2] = uint8_t(state[i] >> 8);
+            out[i * 4 + 3] = uint8_t(state[i]);
+        }
+        return out;
+    }
+
+    /** Lower-case hex of a digest */
+    inline std::string toHex(const Sha256Digest& digest) {
+        static const char* const digits = "0123456789abcdef";
+        std::string hex(64, '0');
+        for (size_t i = 0; i < digest.size(); ++i) {
+            hex[i * 2] = digits[digest[i] >> 4];
+            hex[i * 2 + 1] = digits[digest[i] & 15];
+        }
+        return hex;
+    }
+
+#if defined(SHAREDLIBRARY_ELF)
+    /*--------------------------------------------------------------
+     *  Verify-on-load
+     *  The file is opened once, hashed from a read-only mapping and
+     *  loaded through /proc/self/fd/N, so dlopen maps exactly the
+     *  file that was hashed (from the page cache the hash warmed).
+     *  Hashes are cached per (dev, inode, size, mtime, ctime).
+     *  ld.so names the object after the descriptor (l_name, dladdr);
+     *  this header's reports map that back to the library path.
+     *--------------------------------------------------------------*/
+
+    /** Expected SHA-256, hex; selects the verifying makeSharedLibrary overload */
+    struct ExpectedHash {
+        std::string sha256;
+    };
+
+    namespace detail {
+
+    class VerifyCache {
+    public:
+        static inline VerifyCache& instance() {
+            static VerifyCache* cache = new VerifyCache();     // Leaked: usable during static destruction
+            return *cache;
+        }
+
+        /** Persist entries to `path` (loaded now, appended on every new hash); "" keeps them in memory */
+        inline void setPath(const std::string& path) {
+            std::lock_guard<std::mutex> g(lock_);
+            path_ = path;
+            if (path_.empty()) {
+                return;
+            }
+            if (FILE* f = std::fopen(path_.c_str(), "r")) {
+                Key k;
+                char hex[65];
+                while (std::fscanf(f, "%llx %llx %llx %llx %llx %64s", &k.dev, &k.ino, &k.size, &k.mtime, &k.ctime, hex) == 6) {
+                    entries_[k] = hex;
+                }
+                std::fclose(f);
+            }
+        }
+
+        struct Key {
+            unsigned long long dev = 0, ino = 0, size = 0, mtime = 0, ctime = 0;
+            bool operator<(const Key& o) const {
+                return std::tie(dev, ino, size, mtime, ctime) < std::tie(o.dev, o.ino, o.size, o.mtime, o.ctime);
+            }
+        };
+
+        static inline Key keyOf(const struct stat& st) noexcept {
+            Key k;
+            k.dev = st.st_dev;
+            k.ino = st.st_ino;
+            k.size = static_cast<unsigned long long>(st.st_size);
+            k.mtime = static_cast<unsigned long long>(st.st_mtim.tv_sec) * 1000000000ull + st.st_mtim.tv_nsec;
+            k.ctime = static_cast<unsigned long long>(st.st_ctim.tv_sec) * 1000000000ull + st.st_ctim.tv_nsec;
+            return k;
+        }
+
+        inline bool find(const Key& k, std::string& hex) {
+            std::lock_guard<std::mutex> g(lock_);
+            auto it = entries_.find(k);
+            if (it == entries_.end()) {
+                return false;
+            }
+            hex = it->second;
+            return true;
+        }
+
+        inline void insert(const Key& k, const std::string& hex) {
+            std::lock_guard<std::mutex> g(lock_);
+            entries_[k] = hex;
+            if (!path_.empty()) {
+                if (FILE* f = std::fopen(path_.c_str(), "a")) {
+                    std::fprintf(f, "%llx %llx %llx %llx %llx %s\n", k.dev, k.ino, k.size, k.mtime, k.ctime, hex.c_str());
+                    std::fclose(f);
+                }
+            }
+        }
+
+    private:
+        std::mutex lock_;
+        std::string path_;
+        std::map<Key, std::string> entries_;
+    };
+
+    /** One file on its way through verification */
+    struct VerifyJob {
+        std::string path;
+        std::string expected;
+        int fd = -1;
+        VerifyCache::Key key;
+        std::string actual;
+        std::string error;
+    };
+
+    inline void verifyOpen(VerifyJob& job) {
+        job.fd = ::open(job.path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (job.fd < 0 || ::fstat(job.fd, &st) != 0) {
+            job.error = std::strerror(errno);
+            return;
+        }
+        job.key = VerifyCache::keyOf(st);
+        VerifyCache::instance().find(job.key, job.actual);
+    }
+
+    inline void verifyHash(VerifyJob& job) {
+        if (job.fd < 0 || !job.actual.empty() || !job.error.empty()) {
+            return;
+        }
+        const size_t size = static_cast<size_t>(job.key.size);
+        void* p = size ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, job.fd, 0) : nullptr;
+        if (p == MAP_FAILED) {
+            job.error = std::strerror(errno);
+            return;
+        }
+        if (p) {
+            ::madvise(p, size, MADV_SEQUENTIAL);
+        }
+        job.actual = toHex(sha256(p, size));
+        if (p) {
+            ::munmap(p, size);
+        }
+        VerifyCache::instance().insert(job.key, job.actual);
+    }
+
+    /** Library over the verified descriptor, or throw (closing it) */
+    inline std::unique_ptr<SharedLibraryBase> verifyFinish(VerifyJob& job, bool delayLoad, unsigned mode) {
+        std::string expected = job.expected;
+        std::transform(expected.begin(), expected.end(), expected.begin(), [](char c) { return char(std::tolower(uint8_t(c))); });
+        std::string failure;
+        if (!job.error.empty()) {
+            failure = job.error;
+        } else if (job.actual != expected) {
+            failure = "sha256 mismatch, got " + job.actual;
+        }
+        if (!failure.empty()) {
+            if (job.fd >= 0) {
+                ::close(job.fd);
+            }
+            job.fd = -1;
+            throw std::runtime_error("verify failed – " + job.path + ": " + failure);
+        }
+        auto lib = std::make_unique<SharedLibraryPosix>(job.path, job.fd, delayLoad, mode);
+        job.fd = -1;
+        return lib;
+    }
+
+    }   // namespace detail
+
+    /** Persist verified hashes in `path` so unchanged files are not re-hashed on restart ("" disables) */
+    inline void setVerifyCache(const std::string& path) {
+        detail::VerifyCache::instance().setPath(path);
+    }
+
+    /** Hash `path` (or reuse a cached hash) and compare; the library later loads that very file */
+    inline std::unique_ptr<SharedLibraryBase> makeSharedLibrary(const std::string& path, const ExpectedHash& expected,
+                                                                bool delayLoad = false, unsigned mode = LoadDefault) {
+        detail::VerifyJob job;
+        job.path = path;
+        job.expected = expected.sha256;
+        detail::verifyOpen(job);
+        detail::verifyHash(job);
+        return detail::verifyFinish(job, delayLoad, mode);
+    }
+
+    /** Bulk form: every (path, sha256) hashed in parallel; throws on the first failure, creating none */
+    inline std::vector<std::unique_ptr<SharedLibraryBase>> makeVerifiedLibraries(
+            const std::vector<std::pair<std::string, std::string>>& files, bool delayLoad = false,
+            unsigned mode = LoadDefault, WorkStealingPool& pool = WorkStealingPool::shared()) {
+        std::vector<detail::VerifyJob> jobs(files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            jobs[i].path = files[i].first;
+            jobs[i].expected = files[i].second;
+            detail::verifyOpen(jobs[i]);
+        }
+        pool.parallelFor(jobs.size(), [&](size_t i) { detail::verifyHash(jobs[i]); });
+
+        std::vector<std::unique_ptr<SharedLibraryBase>> libs;
+        try {
+            for (detail::VerifyJob& job : jobs) {
+                libs.push_back(detail::verifyFinish(job, delayLoad, mode));
+            }
+        } catch (...) {
+            for (detail::VerifyJob& job : jobs) {
+                if (job.fd >= 0) {
+                    ::close(job.fd);
+                }
+            }
+            throw;
+        }
+        return libs;
+    }
+#endif
+
+#if defined(SHAREDLIBRARY_ELF)
+    /*--------------------------------------------------------------
+     *  Startup readahead profile
+     *  After warm-up, record() asks mincore() which pages of each
+     *  loaded library file sit in the page cache and keeps them as
+     *  byte ranges keyed by build-id. On a later start, prefetch()
+     *  issues readahead() for exactly those ranges before the
+     *  libraries are loaded, instead of faulting them in page by page.
+     *--------------------------------------------------------------*/
+    struct FileRange {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    namespace detail {
+
+    /** Read-only mapping of a whole file for mincore(); nothing is read until touched */
+    class FileMapping {
+    public:
+        explicit FileMapping(const std::string& path) {
+            fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if (fd_ < 0 || ::fstat(fd_, &st) != 0 || st.st_size <= 0) {
+                return;
+            }
+            size_ = static_cast<size_t>(st.st_size);
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+            data_ = p == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(p);
+        }
+
+        ~FileMapping() {
+            if (data_) {
+                ::munmap(const_cast<unsigned char*>(data_), size_);
+            }
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+        }
+
+        FileMapping(const FileMapping&) = delete;
+        FileMapping& operator=(const FileMapping&) = delete;
+
+        inline const unsigned char* data() const noexcept { return data_; }
+        inline size_t size() const noexcept { return size_; }
+        inline int fd() const noexcept { return fd_; }
+
+    private:
+        int fd_ = -1;
+        size_t size_ = 0;
+        const unsigned char* data_ = nullptr;
+    };
+
+    /** NT_GNU_BUILD_ID of an ELF file as hex, "" when absent; pread() only, so no mmap fault-around */
+    inline std::string elfBuildId(int fd) {
+        ElfW(Ehdr) eh;
+        if (fd < 0 || ::pread(fd, &eh, sizeof(eh), 0) != static_cast<ssize_t>(sizeof(eh))
+            || std::memcmp(eh.e_ident, ELFMAG, SELFMAG) != 0
+            || eh.e_ident[EI_CLASS] != (sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32)
+            || eh.e_phentsize != sizeof(ElfW(Phdr)) || eh.e_phnum == 0) {
+            return {};
+        }
+        std::vector<ElfW(Phdr)> ph(eh.e_phnum);
+        const size_t phBytes = ph.size() * sizeof(ElfW(Phdr));
+        if (::pread(fd, ph.data(), phBytes, static_cast<off_t>(eh.e_phoff)) != static_cast<ssize_t>(phBytes)) {
+            return {};
+        }
+        for (const ElfW(Phdr)& p : ph) {
+            if (p.p_type != PT_NOTE || p.p_filesz > (1u << 16)) {
+                continue;
+            }
+            std::vector<unsigned char> notes(p.p_filesz);
+            if (::pread(fd, notes.data(), notes.size(), static_cast<off_t>(p.p_offset)) != static_cast<ssize_t>(notes.size())) {
+                continue;
+            }
+            size_t at = 0;
+            while (at + sizeof(ElfW(Nhdr)) <= notes.size()) {
+                ElfW(Nhdr) nh;
+                std::memcpy(&nh, notes.data() + at, sizeof(nh));
+                const size_t name = at + sizeof(ElfW(Nhdr));
+                const size_t desc = name + ((nh.n_namesz + 3u) & ~size_t(3));
+                if (desc + nh.n_descsz > notes.size()) {
+                    break;
+                }
+                if (nh.n_type == NT_GNU_BUILD_ID && nh.n_namesz == 4 && std::memcmp(notes.data() + name, "GNU", 4) == 0) {
+                    static const char digits[] = "0123456789abcdef";
+                    std::string hex;
+                    for (size_t k = 0; k < nh.n_descsz; ++k) {
+                        hex += digits[notes[desc + k] >> 4];
+                        hex += digits[notes[desc + k] & 15];
+                    }
+                    return hex;
+                }
+                at = desc + ((nh.n_descsz + 3u) & ~size_t(3));
+            }
+        }
+        return {};
+    }
+
+    }   // namespace detail
+
+    class ReadaheadProfile {
+    public:
+        /** Profile stored at `path` (read now if it exists; "" keeps it in memory) */
+        explicit ReadaheadProfile(std::string path = std::string()) : path_(std::move(path)) {
+            if (!path_.empty()) {
+                load();
+            }
+        }
+
+        /** Record the resident pages of every loaded library; returns how many were recorded */
+        inline size_t record() {
+            std::vector<std::string> paths;
+            for (const auto& e : detail::LibraryRegistry::instance().snapshot()) {
+                if (std::find(paths.begin(), paths.end(), e.path) == paths.end()) {
+                    paths.push_back(e.path);
+                }
+            }
+            size_t n = 0;
+            for (const std::string& p : paths) {
+                n += record(p);
+            }
+            return n;
+        }
+
+        /** Record the page-cache residency of one library file */
+        inline bool record(const std::string& libraryPath) {
+            detail::FileMapping file(libraryPath);
+            if (!file.data()) {
+                return false;
+            }
+            const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            const size_t pages = (file.size() + page - 1) / page;
+            std::vector<unsigned char> resident(pages);
+            if (::mincore(const_cast<unsigned char*>(file.data()), file.size(), resident.data()) != 0) {
+                return false;
+            }
+            Entry entry{ libraryPath, file.size(), {} };
+            for (size_t i = 0; i < pages;) {
+                if (!(resident[i] & 1)) {
+                    ++i;
+                    continue;
+                }
+                size_t j = i;
+                while (j < pages && (resident[j] & 1)) {
+                    ++j;
+                }
+                entry.ranges.push_back({ uint64_t(i) * page, std::min<uint64_t>(uint64_t(j - i) * page, file.size() - uint64_t(i) * page) });
+                i = j;
+            }
+            const std::string key = keyOf(libraryPath, file.fd());
+            std::lock_guard<std::mutex> g(lock_);
+            entries_[key] = std::move(entry);
+            return true;
+        }
+
+        /** readahead() the recorded ranges of a library; returns bytes requested, 0 when unknown or rebuilt */
+        inline uint64_t prefetch(const std::string& libraryPath) const {
+            const int fd = ::open(libraryPath.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if (fd < 0 || ::fstat(fd, &st) != 0) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                return 0;
+            }
+            std::vector<FileRange> ranges;
+            {
+                const std::string key = keyOf(libraryPath, fd);
+                std::lock_guard<std::mutex> g(lock_);
+                auto it = entries_.find(key);
+                if (it != entries_.end() && it->second.size == static_cast<uint64_t>(st.st_size)) {
+                    ranges = it->second.ranges;
+                }
+            }
+            uint64_t bytes = 0;
+            for (const FileRange& r : ranges) {
+                if (::readahead(fd, static_cast<off64_t>(r.offset), static_cast<size_t>(r.length)) == 0) {
+                    bytes += r.length;
+                }
+            }
+            ::close(fd);
+            return bytes;
+        }
+
+        /** prefetch() every library in the profile, e.g. first thing in main() */
+        inline uint64_t prefetchAll() const {
+            std::vector<std::string> paths;
+            {
+                std::lock_guard<std::mutex> g(lock_);
+                for (const auto& e : entries_) {
+                    paths.push_back(e.second.path);
+                }
+            }
+            uint64_t bytes = 0;
+            for (const std::string& p : paths) {
+                bytes += prefetch(p);
+            }
+            return bytes;
+        }
+
+        /** Recorded ranges of a library file as it is now on disk */
+        inline std::vector<FileRange> ranges(const std::string& libraryPath) const {
+            const int fd = ::open(libraryPath.c_str(), O_RDONLY | O_CLOEXEC);
+            const std::string key = keyOf(libraryPath, fd);
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            std::lock_guard<std::mutex> g(lock_);
+            auto it = entries_.find(key);
+            return it == entries_.end() ? std::vector<FileRange>() : it->second.ranges;
+        }
+
+        /** Write the profile to its path: "key <TAB> path <TAB> size <TAB> offset+length,..." */
+        inline void save() const {
+            std::lock_guard<std::mutex> g(lock_);
+            FILE* f = std::fopen(path_.c_str(), "w");
+            if (!f) {
+                throw std::runtime_error("ReadaheadProfile::save failed – " + path_);
+            }
+            std::fprintf(f, "# sharedlibrary readahead v1\n");
+            for (const auto& e : entries_) {
+                std::fprintf(f, "%s\t%s\t%llu\t", e.first.c_str(), e.second.path.c_str(), static_cast<unsigned long long>(e.second.size));
+                for (size_t i = 0; i < e.second.ranges.size(); ++i) {
+                    std::fprintf(f, "%s%llu+%llu", i ? "," : "", static_cast<unsigned long long>(e.second.ranges[i].offset),
+                        static_cast<unsigned long long>(e.second.ranges[i].length));
+                }
+                std::fprintf(f, "\n");
+            }
+            std::fclose(f);
+        }
+
+    private:
+        struct Entry {
+            std::string path;
+            uint64_t size;
+            std::vector<FileRange> ranges;
+        };
+
+        /** Build-id, or the path for files built without one */
+        static inline std::string keyOf(const std::string& path, int fd) {
+            std::string id = detail::elfBuildId(fd);
+            return id.empty() ? "path:" + path : id;
+        }
+
+        inline void load() {
+            FILE* f = std::fopen(path_.c_str(), "r");
+            if (!f) {
+                return;
+            }
+            std::string line;
+            char buf[4096];
+            while (std::fgets(buf, sizeof(buf), f)) {
+                line += buf;
+                if (line.back() != '\n' && !std::feof(f)) {
+                    continue;           // Long range lists span several reads
+                }
+                while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+                    line.pop_back();
+                }
+                const size_t a = line.find('\t');
+                const size_t b = a == std::string::npos ? a : line.find('\t', a + 1);
+                const size_t c = b == std::string::npos ? b : line.find('\t', b + 1);
+                if (!line.empty() && line[0] != '#' && c != std::string::npos) {
+                    Entry entry{ line.substr(a + 1, b - a - 1), std::strtoull(line.c_str() + b + 1, nullptr, 10), {} };
+                    for (const char* p = line.c_str() + c + 1; *p;) {
+                        char* end = nullptr;
+                        const uint64_t offset = std::strtoull(p, &end, 10);
+                        if (*end != '+') {
+                            break;
+                        }
+                        const uint64_t length = std::strtoull(end + 1, &end, 10);
+                        entry.ranges.push_back({ offset, length });
+                        p = *end == ',' ? end + 1 : end;
+                    }
+                    entries_[line.substr(0, a)] = std::move(entry);
+                }
+                line.clear();
+            }
+            std::fclose(f);
+        }
+
+        std::string path_;
+        mutable std::mutex lock_;
+        std::map<std::string, Entry> entries_;     // build-id (or "path:...") -> resident ranges
+    };
+#endif
+
+#if defined(SHAREDLIBRARY_ELF)
+    /*--------------------------------------------------------------
+     *  Snapshot and reset of a library's writable state
+     *  Copies the writable PT_LOAD segments (.data, .bss, lazy GOT)
+     *  of a loaded object, minus RELRO, and later writes them back in
+     *  place: memcpy for pages holding data, MADV_DONTNEED for long
+     *  zero runs of anonymous .bss. Refused when the state is not all
+     *  in those segments: thread-locals, or pointers into the heap.
+     *  Nothing may call into the library while restore() runs.
+     *--------------------------------------------------------------*/
+    struct SnapshotOptions {
+        bool allowHeapPointers = false;     // Take the snapshot even if .data/.bss point into anonymous memory
+        size_t madviseMinPages = 16;        // Shortest zero run of anonymous .bss reset with MADV_DONTNEED
+    };
+
+    class LibrarySnapshot {
+    public:
+        /** Capture now, e.g. right after loadNow(); throws when the state cannot be fully captured */
+        explicit LibrarySnapshot(const SharedLibraryBase& lib, SnapshotOptions options = SnapshotOptions())
+            : lib_(&lib), handle_(lib.nativeHandle()), generation_(lib.generation()), options_(options) {
+            if (!handle_) {
+                fail("library is not loaded");
+            }
+            struct link_map* lm = nullptr;
+            if (::dlinfo(handle_, RTLD_DI_LINKMAP, &lm) != 0 || !lm) {
+                fail("no link map");
+            }
+            Layout layout{ lm->l_ld, {}, 0, 0, false, false };
+            ::dl_iterate_phdr(&LibrarySnapshot::collect, &layout);
+            if (!layout.found) {
+                fail("image not found");
+            }
+            if (layout.tls) {
+                fail("library has thread-local storage");
+            }
+            const uintptr_t page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+            const uintptr_t relroBegin = layout.relroBegin & ~(page - 1);
+            const uintptr_t relroEnd = layout.relroEnd & ~(page - 1);
+            for (const Range& w : layout.writable) {
+                uintptr_t begin = w.begin;
+                if (relroEnd > relroBegin && begin >= relroBegin && begin < relroEnd) {
+                    begin = std::min(w.end, relroEnd);  // RELRO leads the segment and is read-only by now
+                }
+                if (begin < w.end) {
+                    Segment s;
+                    s.begin = begin;
+                    s.end = w.end;
+                    s.anonFrom = std::max(begin, (w.fileEnd + page - 1) & ~(page - 1));
+                    s.image.assign(reinterpret_cast<const unsigned char*>(begin), reinterpret_cast<const unsigned char*>(w.end));
+                    segments_.push_back(std::move(s));
+                }
+            }
+            if (!options_.allowHeapPointers) {
+                checkHeapPointers();
+            }
+            for (Segment& s : segments_) {
+                plan(s, page);
+            }
+        }
+
+        /** Write the captured state back; the library must still be the same loaded instance */
+        inline void restore() {
+            if (lib_->generation() != generation_ || !lib_->isLoaded()) {
+                fail("library was unloaded or reloaded since the snapshot");
+            }
+            for (const Segment& s : segments_) {
+                for (const Run& r : s.runs) {
+                    auto* dst = reinterpret_cast<unsigned char*>(s.begin + r.offset);
+                    switch (r.kind) {
+                    case Run::Copy:
+                        std::memcpy(dst, s.image.data() + r.offset, r.length);
+                        break;
+                    case Run::Zero:
+                        std::memset(dst, 0, r.length);
+                        break;
+                    case Run::Drop:
+                        if (::madvise(dst, r.length, MADV_DONTNEED) != 0) {
+                            std::memset(dst, 0, r.length);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        /** Captured bytes */
+        inline size_t bytes() const noexcept {
+            size_t n = 0;
+            for (const Segment& s : segments_) {
+                n += s.image.size();
+            }
+            return n;
+        }
+
+    private:
+        struct Range {
+            uintptr_t begin, end, fileEnd;      // fileEnd: end of the file-backed part (p_filesz)
+        };
+
+        struct Layout {
+            const void* dynamic;
+            std::vector<Range> writable;
+            uintptr_t relroBegin, relroEnd;
+            bool tls, found;
+        };
+
+        struct Run {
+            enum Kind { Copy, Zero, Drop } kind;
+            size_t offset, length;
+        };
+
+        struct Segment {
+            uintptr_t begin = 0, end = 0;
+            uintptr_t anonFrom = 0;             // Page-aligned start of the anonymous (.bss only) pages
+            std::vector<unsigned char> image;
+            std::vector<Run> runs;
+        };
+
+        [[noreturn]] static inline void fail(const char* why) {
+            throw std::runtime_error(std::string("LibrarySnapshot failed – ") + why);
+        }
+
+        static inline int collect(struct dl_phdr_info* info, size_t, void* data) {
+            auto* layout = static_cast<Layout*>(data);
+            bool same = false;
+            for (unsigned i = 0; i < info->dlpi_phnum; ++i) {
+                const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+                if (ph.p_type == PT_DYNAMIC && info->dlpi_addr + ph.p_vaddr == reinterpret_cast<uintptr_t>(layout->dynamic)) {
+                    same = true;
+                }
+            }
+            if (!same) {
+                return 0;
+            }
+            for (unsigned i = 0; i < info->dlpi_phnum; ++i) {
+                const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+                const uintptr_t at = info->dlpi_addr + ph.p_vaddr;
+                if (ph.p_type == PT_LOAD && (ph.p_flags & PF_W) && ph.p_memsz) {
+                    layout->writable.push_back({ at, at + ph.p_memsz, at + ph.p_filesz });
+                } else if (ph.p_type == PT_GNU_RELRO) {
+                    layout->relroBegin = at;
+                    layout->relroEnd = at + ph.p_memsz;
+                } else if (ph.p_type == PT_TLS && ph.p_memsz) {
+                    layout->tls = true;
+                }
+            }
+            layout->found = true;
+            return 1;
+        }
+
+        /** PT_LOAD ranges of every loaded object: their .bss is unnamed in /proc/self/maps too */
+        static inline int collectImages(struct dl_phdr_info* info, size_t, void* data) {
+            auto* images = static_cast<std::vector<std::pair<uintptr_t, uintptr_t>>*>(data);
+            for (unsigned i = 0; i < info->dlpi_phnum; ++i) {
+                const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+                if (ph.p_type == PT_LOAD && ph.p_memsz) {
+                    const uintptr_t at = info->dlpi_addr + ph.p_vaddr;
+                    images->emplace_back(at, at + ph.p_memsz);
+                }
+            }
+            return 0;
+        }
+
+        /** Refuse words that point into anonymous read-write mappings: heap, mmap'd blocks, thread stacks */
+        inline void checkHeapPointers() const {
+            std::vector<std::pair<uintptr_t, uintptr_t>> anon;
+            if (FILE* maps = std::fopen("/proc/self/maps", "r")) {
+                char line[512];
+                while (std::fgets(line, sizeof(line), maps)) {
+                    unsigned long long lo = 0, hi = 0, offset = 0, inode = 0;
+                    char perms[8] = {}, dev[16] = {};
+                    int pathAt = 0;
+                    if (std::sscanf(line, "%llx-%llx %7s %llx %15s %llu %n", &lo, &hi, perms, &offset, dev, &inode, &pathAt) < 6) {
+                        continue;
+                    }
+                    const char* path = line + pathAt;
+                    const bool named = *path && *path != '\n';
+                    if (perms[1] == 'w' && inode == 0 && (!named || std::strncmp(path, "[heap]", 6) == 0)) {
+                        anon.emplace_back(static_cast<uintptr_t>(lo), static_cast<uintptr_t>(hi));
+                    }
+                }
+                std::fclose(maps);
+            }
+            std::vector<std::pair<uintptr_t, uintptr_t>> images;
+            ::dl_iterate_phdr(&LibrarySnapshot::collectImages, &images);
+            auto inImage = [&](uintptr_t v) {
+                for (const auto& r : images) {
+                    if (v >= r.first && v < r.second) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+            for (const Segment& s : segments_) {
+                const size_t skew = (sizeof(uintptr_t) - s.begin % sizeof(uintptr_t)) % sizeof(uintptr_t);
+                for (size_t at = skew; at + sizeof(uintptr_t) <= s.image.size(); at += sizeof(uintptr_t)) {
+                    uintptr_t v;
+                    std::memcpy(&v, s.image.data() + at, sizeof(v));
+                    if (v < 0x10000 || inOwnSegments(v) || inImage(v)) {
+                        continue;
+                    }
+                    for (const auto& r : anon) {
+                        if (v >= r.first && v < r.second) {
+                            char why[96];
+                            std::snprintf(why, sizeof(why), "word at +0x%zx points into anonymous memory (heap)", at);
+                            fail(why);
+                        }
+                    }
+                }
+            }
+        }
+
+        inline bool inOwnSegments(uintptr_t v) const noexcept {
+            for (const Segment& s : segments_) {
+                if (v >= s.begin && v < s.end) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Split a segment into copy runs and zero runs; long page-aligned zero runs of .bss become madvise drops */
+        inline void plan(Segment& s, uintptr_t page) const {
+            const size_t size = s.image.size();
+            size_t i = 0;
+            while (i < size) {
+                const size_t chunkEnd = std::min(size, static_cast<size_t>(((s.begin + i) / page + 1) * page - s.begin));
+                bool zero = true;
+                for (size_t k = i; k < chunkEnd && zero; ++k) {
+                    zero = s.image[k] == 0;
+                }
+                const Run::Kind kind = zero ? Run::Zero : Run::Copy;
+                if (!s.runs.empty() && s.runs.back().kind == kind && s.runs.back().offset + s.runs.back().length == i) {
+                    s.runs.back().length += chunkEnd - i;
+                } else {
+                    s.runs.push_back({ kind, i, chunkEnd - i });
+                }
+                i = chunkEnd;
+            }
+            // Zero runs over whole anonymous pages: drop instead of memset when long enough
+            std::vector<Run> runs;
+            for (const Run& r : s.runs) {
+                const uintptr_t a = std::max<uintptr_t>(s.begin + r.offset, s.anonFrom);
+                const uintptr_t from = (a + page - 1) & ~(page - 1);
+                const uintptr_t to = (s.begin + r.offset + r.length) & ~(page - 1);
+                if (r.kind != Run::Zero || to <= from || (to - from) / page < options_.madviseMinPages) {
+                    runs.push_back(r);
+                    continue;
+                }
+                const size_t head = from - (s.begin + r.offset);
+                const size_t tail = s.begin + r.offset + r.length - to;
+                if (head) runs.push_back({ Run::Zero, r.offset, head });
+                runs.push_back({ Run::Drop, r.offset + head, to - from });
+                if (tail) runs.push_back({ Run::Zero, r.offset + r.length - tail, tail });
+            }
+            s.runs = std::move(runs);
+        }
+
+        const SharedLibraryBase* lib_;
+        void* handle_;
+        uint64_t generation_;
+        SnapshotOptions options_;
+        std::vector<Segment> segments_;
+    };
+#endif
+
+#if defined(SHAREDLIBRARY_ELF)
+    /*--------------------------------------------------------------
+     *  Dynamic-linker binding statistics (LD_AUDIT)
+     *  audit/SharedLibraryAudit.cpp, loaded with LD_AUDIT, counts every
+     *  symbol binding ld.so performs (la_symbind64) per referencing and
+     *  defining object, and publishes the counts in a POSIX shared
+     *  memory segment named after the pid. bindingStats() reads it, from
+     *  the audited process itself or from any other process.
+     *--------------------------------------------------------------*/
+    namespace audit {
+
+    constexpr uint32_t Magic = 0x53484144;          // "SHAD"
+    constexpr uint32_t Version = 1;
+    constexpr uint32_t MaxObjects = 512;
+    constexpr uint32_t MaxEdges = 4096;             // Power of two: open addressing
+    constexpr uint32_t MaxSymbols = 8192;           // Power of two: open addressing
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "audit counters live in shared memory");
+
+    struct Object {
+        char name[256];                         // l_name; the executable as "/proc/self/exe"
+        std::atomic<uint64_t> bindsFrom;
+        std::atomic<uint64_t> bindsTo;
+        std::atomic<uint64_t> searchNs;
+        std::atomic<uint64_t> searchDepth;      // Objects searched, summed over bindsFrom
+    };
+
+    struct Edge {
+        std::atomic<uint64_t> key;              // edgeKey(from, to); 0: empty slot
+        std::atomic<uint64_t> binds;
+        std::atomic<uint64_t> searchNs;
+    };
+
+    struct Symbol {
+        std::atomic<uint64_t> key;              // symbolKey(edge key, name); 0: empty slot
+        std::atomic<uint64_t> binds;
+        uint64_t edge;                          // Edge key, valid once ready
+        std::atomic<uint32_t> ready;
+        char name[108];
+    };
+
+    struct Shared {
+        uint32_t magic;
+        uint32_t version;
+        std::atomic<uint32_t> objects;          // Published entries of object[]
+        std::atomic<uint64_t> binds;
+        std::atomic<uint64_t> searchNs;
+        std::atomic<uint64_t> dropped;          // Bindings not counted per edge or symbol: a table was full
+        Object object[MaxObjects];
+        Edge edge[MaxEdges];
+        Symbol symbol[MaxSymbols];
+    };
+
+    inline std::string shmName(pid_t pid) {
+        return "/sharedlibrary-audit." + std::to_string(pid);
+    }
+
+    inline constexpr uint64_t edgeKey(uint32_t from, uint32_t to) noexcept {
+        return (uint64_t(from) + 1) << 32 | (uint64_t(to) + 1);
+    }
+
+    /** FNV-1a of the name, mixed with the edge; never 0 */
+    inline uint64_t symbolKey(uint64_t edge, const char* name) noexcept {
+        uint64_t h = 0xcbf29ce484222325ull ^ (edge * 0x9e3779b97f4a7c15ull);
+        for (; *name; ++name) {
+            h = (h ^ static_cast<unsigned char>(*name)) * 0x100000001b3ull;
+        }
+        return h ? h : 1;
+    }
+
+    }   // namespace audit
+
+    struct BindingEdge {
+        std::string from;               // Referencing object
+        std::string to;                 // Defining object
+        uint64_t binds = 0;
+        double searchNs = 0;
+    };
+
+    struct BoundSymbol {
+        std::string from;
+        std::string to;
+        std::string symbol;
+        uint64_t binds = 0;
+    };
+
+    struct BindingStats {
+        bool audited = false;           // The process runs under the LD_AUDIT module
+        uint64_t binds = 0;
+        double searchNs = 0;
+        uint64_t dropped = 0;
+        std::vector<LibraryBindingStats> libraries;     // Merged by path, most bindsFrom first
+        std::vector<BindingEdge> edges;                 // Most binds first
+        std::vector<BoundSymbol> symbols;               // Most binds first
+    };
+
+    /** Binding statistics of an audited process (default: this one); audited == false when none are published */
+    inline BindingStats bindingStats(pid_t pid = ::getpid()) {
+        BindingStats out;
+        const int fd = ::shm_open(audit::shmName(pid).c_str(), O_RDONLY | O_CLOEXEC, 0);
+        if (fd < 0) {
+            return out;
+        }
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(audit::Shared)) {
+            p = ::mmap(nullptr, sizeof(audit::Shared), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return out;
+        }
+        const auto& s = *static_cast<const audit::Shared*>(p);
+        if (s.magic != audit::Magic || s.version != audit::Version) {
+            ::munmap(p, sizeof(audit::Shared));
+            return out;
+        }
+        out.audited = true;
+        out.binds = s.binds.load(std::memory_order_relaxed);
+        out.searchNs = static_cast<double>(s.searchNs.load(std::memory_order_relaxed));
+        out.dropped = s.dropped.load(std::memory_order_relaxed);
+
+        const uint32_t objects = std::min(s.objects.load(std::memory_order_acquire), audit::MaxObjects);
+        std::vector<std::string> names(objects);
+        std::vector<size_t> row(objects);
+        std::vector<uint64_t> depth;
+        std::map<std::string, size_t> byName;
+        std::map<std::string, std::string> aliases;     // Verified loads: descriptor path -> library path
+        for (const auto& e : detail::LibraryRegistry::instance().snapshot()) {
+            struct link_map* lm = nullptr;
+            if (::dlinfo(e.handle, RTLD_DI_LINKMAP, &lm) == 0 && lm && detail::isDescriptorPath(lm->l_name)) {
+                aliases.emplace(lm->l_name, e.path);
+            }
+        }
+        for (uint32_t i = 0; i < objects; ++i) {
+            const audit::Object& o = s.object[i];
+            names[i].assign(o.name, strnlen(o.name, sizeof(o.name)));
+            const auto alias = aliases.find(names[i]);
+            if (alias != aliases.end()) {
+                names[i] = alias->second;
+            }
+            auto it = byName.emplace(names[i], out.libraries.size()).first;
+            if (it->second == out.libraries.size()) {
+                out.libraries.push_back({});
+                out.libraries.back().path = names[i];
+                depth.push_back(0);
+            }
+            row[i] = it->second;
+            LibraryBindingStats& l = out.libraries[row[i]];
+            l.bindsFrom += o.bindsFrom.load(std::memory_order_relaxed);
+            l.bindsTo += o.bindsTo.load(std::memory_order_relaxed);
+            l.searchNs += static_cast<double>(o.searchNs.load(std::memory_order_relaxed));
+            depth[row[i]] += o.searchDepth.load(std::memory_order_relaxed);
+        }
+        auto endpoint = [&](uint64_t key, bool from) -> int64_t {
+            const uint64_t idx = (from ? key >> 32 : key & 0xffffffffu) - 1;
+            return idx < objects ? static_cast<int64_t>(idx) : -1;
+        };
+        std::map<std::pair<size_t, size_t>, BindingEdge> edges;
+        for (const audit::Edge& e : s.edge) {
+            const uint64_t key = e.key.load(std::memory_order_acquire);
+            const int64_t from = key ? endpoint(key, true) : -1, to = key ? endpoint(key, false) : -1;
+            if (from < 0 || to < 0) {
+                continue;
+            }
+            const uint64_t binds = e.binds.load(std::memory_order_relaxed);
+            BindingEdge& be = edges[{ row[from], row[to] }];
+            be.from = names[from];
+            be.to = names[to];
+            be.binds += binds;
+            be.searchNs += static_cast<double>(e.searchNs.load(std::memory_order_relaxed));
+            if (row[from] == row[to]) {
+                out.libraries[row[from]].selfBinds += binds;
+            }
+        }
+        for (auto& e : edges) {
+            out.edges.push_back(std::move(e.second));
+        }
+        for (const audit::Symbol& sym : s.symbol) {
+            if (!sym.key.load(std::memory_order_relaxed) || !sym.ready.load(std::memory_order_acquire)) {
+                continue;
+            }
+            const int64_t from = endpoint(sym.edge, true), to = endpoint(sym.edge, false);
+            if (from < 0 || to < 0) {
+                continue;
+            }
+            out.symbols.push_back({ names[from], names[to],
+                std::string(sym.name, strnlen(sym.name, sizeof(sym.name))), sym.binds.load(std::memory_order_relaxed) });
+        }
+        ::munmap(p, sizeof(audit::Shared));
+
+        for (size_t i = 0; i < out.libraries.size(); ++i) {
+            LibraryBindingStats& l = out.libraries[i];
+            l.meanSearchDepth = l.bindsFrom ? static_cast<double>(depth[i]) / static_cast<double>(l.bindsFrom) : 0.0;
+        }
+        std::stable_sort(out.libraries.begin(), out.libraries.end(),
+            [](const LibraryBindingStats& a, const LibraryBindingStats& b) { return a.bindsFrom > b.bindsFrom; });
+        std::stable_sort(out.edges.begin(), out.edges.end(),
+            [](const BindingEdge& a, const BindingEdge& b) { return a.binds > b.binds; });
+        std::stable_sort(out.symbols.begin(), out.symbols.end(),
+            [](const BoundSymbol& a, const BoundSymbol& b) { return a.binds > b.binds; });
+        return out;
+    }
+
+    inline LibraryBindingStats SharedLibraryBase::bindingStats() const {
+        LibraryBindingStats out;
+        struct link_map* lm = nullptr;
+        void* handle = nativeHandle();
+        if (!handle || ::dlinfo(handle, RTLD_DI_LINKMAP, &lm) != 0 || !lm) {
+            out.path = path();
+            return out;
+        }
+        // The module records l_name as ld.so has it, which is what dlinfo returns here;
+        // sharedlibrary::bindingStats() reports verified loads under their library path
+        out.path = detail::isDescriptorPath(lm->l_name) ? path() : (lm->l_name && *lm->l_name) ? lm->l_name : "/proc/self/exe";
+        for (LibraryBindingStats& l : sharedlibrary::bindingStats().libraries) {
+            if (l.path == out.path) {
+                return std::move(l);
+            }
+        }
+        return out;
+    }
+#endif
+
+#if defined(SHAREDLIBRARY_ELF)
+    /*--------------------------------------------------------------
+     *  Sampling CPU profiler
+     *  SIGPROF from a process CPU-time timer; the handler captures the
+     *  PC and a frame-pointer chain (read with process_vm_readv, so a
+     *  bad chain never faults) into a preallocated ring. Reports map
+     *  samples to loaded SharedLibraryBase objects and their symbols.
+     *--------------------------------------------------------------*/
+    struct FlatEntry {
+        std::string name;               // Library path, or "lib!symbol"
+        uint64_t selfSamples = 0;       // Samples whose leaf frame is here
+        uint64_t totalSamples = 0;      // Samples with any frame here
+        double selfPercent = 0;
+        double totalPercent = 0;
+    };
+
+    struct SampleProfile {
+        uint64_t samples = 0;
+        uint64_t dropped = 0;           // Lost to a full ring
+        std::vector<FlatEntry> libraries;   // Managed libraries, plus "[other]"
+        std::vector<FlatEntry> symbols;
+    };
+
+    struct SamplerOptions {
+        unsigned hz = 997;              // Samples per CPU-second; the overhead knob
+        unsigned maxDepth = 32;         // Frames per sample, 1 = PC only
+        size_t capacity = 1u << 16;     // Ring size in samples
+    };
+
+    class CpuSampler {
+    public:
+        explicit CpuSampler(SamplerOptions options = SamplerOptions()) : options_(options) {
+            options_.maxDepth = options_.maxDepth ? options_.maxDepth : 1;
+            options_.hz = options_.hz ? options_.hz : 1;
+            stride_ = options_.maxDepth + 1;
+            ring_.reset(new uintptr_t[options_.capacity * stride_]());     // Depth 0: no record yet
+        }
+
+        ~CpuSampler() {
+            stop();
+        }
+
+        CpuSampler(const CpuSampler&) = delete;
+        CpuSampler& operator=(const CpuSampler&) = delete;
+
+        /** Install the handler and arm the timer (one running sampler per process) */
+        inline void start() {
+            CpuSampler* expected = nullptr;
+            if (!active().compare_exchange_strong(expected, this)) {
+                if (expected == this) {
+                    return;
+                }
+                throw std::runtime_error("CpuSampler::start failed – another sampler is running");
+            }
+            stopped_ = false;               // Reports follow the live registry again until the next stop()
+            libraries_.clear();
+            enableSymbolIndex();
+            pid_ = ::getpid();
+            struct sigaction sa;
+            std::memset(&sa, 0, sizeof(sa));
+            sa.sa_sigaction = &CpuSampler::onSignal;
+            sa.sa_flags = SA_SIGINFO | SA_RESTART;
+            sigemptyset(&sa.sa_mask);
+            ::sigaction(SIGPROF, &sa, &previous_);
+
+            const long interval = 1000000000L / static_cast<long>(options_.hz);
+            struct sigevent sev;
+            std::memset(&sev, 0, sizeof(sev));
+            sev.sigev_notify = SIGEV_SIGNAL;
+            sev.sigev_signo = SIGPROF;
+            struct itimerspec spec;
+            spec.it_interval.tv_sec = spec.it_value.tv_sec = interval / 1000000000L;
+            spec.it_interval.tv_nsec = spec.it_value.tv_nsec = interval % 1000000000L;
+            if (::timer_create(CLOCK_PROCESS_CPUTIME_ID, &sev, &timer_) == 0 && ::timer_settime(timer_, 0, &spec, nullptr) == 0) {
+                hasTimer_ = true;
+                return;
+            }
+            // Fallback: the classic profiling interval timer
+            struct itimerval it;
+            it.it_interval.tv_sec = it.it_value.tv_sec = interval / 1000000000L;
+            it.it_interval.tv_usec = it.it_value.tv_usec = (interval % 1000000000L) / 1000;
+            if (::setitimer(ITIMER_PROF, &it, nullptr) != 0) {
+                ::sigaction(SIGPROF, &previous_, nullptr);
+                active().store(nullptr);
+                throw std::runtime_error("CpuSampler::start failed – no profiling timer available");
+            }
+        }
+
+        /** Disarm, wait for in-flight handlers, restore the previous handler */
+        inline void stop() {
+            if (active().load() != this) {
+                return;
+            }
+            if (hasTimer_) {
+                ::timer_delete(timer_);
+                hasTimer_ = false;
+            } else {
+                struct itimerval off;
+                std::memset(&off, 0, sizeof(off));
+                ::setitimer(ITIMER_PROF, &off, nullptr);
+            }
+            active().store(nullptr);
+            while (inFlight().load() != 0) {
+                std::this_thread::yield();
+            }
+            ::sigaction(SIGPROF, &previous_, nullptr);
+            libraries_ = detail::LibraryRegistry::instance().snapshot();
+            stopped_ = true;
+        }
+
+        /** Drop collected samples */
+        inline void reset() noexcept {
+            next_.store(0);
+            dropped_.store(0);
+            for (uint64_t i = 0; i < options_.capacity; ++i) {
+                __atomic_store_n(&ring_[i * stride_], uintptr_t(0), __ATOMIC_RELEASE);
+            }
+        }
+
+        inline uint64_t samples() const noexcept {
+            return std::min<uint64_t>(next_.load(std::memory_order_acquire), options_.capacity);
+        }
+
+        inline uint64_t dropped() const noexcept {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+        /** Self/total shares per managed library and per symbol */
+        inline SampleProfile flatProfile() const {
+            SampleProfile out;
+            out.dropped = dropped();
+            const uint64_t claimed = samples();
+            Symbolizer sym(stopped_ ? libraries_ : detail::LibraryRegistry::instance().snapshot());
+            sym.prime(ring_.get(), claimed, stride_, options_.maxDepth);
+            std::map<std::string, FlatEntry> libs, syms;
+            std::vector<const std::string*> seenLibs, seenSyms;
+            for (uint64_t i = 0; i < claimed; ++i) {
+                const uintptr_t* rec = &ring_[i * stride_];
+                const uintptr_t depth = depthOf(rec, options_.maxDepth);
+                if (!depth) {
+                    continue;
+                }
+                ++out.samples;
+                seenLibs.clear();
+                seenSyms.clear();
+                for (uintptr_t d = 0; d < depth; ++d) {
+                    const Frame& f = sym.resolve(rec[1 + d], d == 0);
+                    FlatEntry& le = libs[f.library];
+                    FlatEntry& se = syms[f.symbol];
+                    if (d == 0) {
+                        ++le.selfSamples;
+                        ++se.selfSamples;
+                    }
+                    // Recursion and repeated frames count once toward totals
+                    auto once = [](std::vector<const std::string*>& seen, const std::string& name) {
+                        for (const std::string* s : seen) {
+                            if (*s == name) {
+                                return false;
+                            }
+                        }
+                        seen.push_back(&name);
+                        return true;
+                    };
+                    if (once(seenLibs, f.library)) {
+                        ++le.totalSamples;
+                    }
+                    if (once(seenSyms, f.symbol)) {
+                        ++se.totalSamples;
+                    }
+                }
+            }
+            auto finish = [&](std::map<std::string, FlatEntry>& in, std::vector<FlatEntry>& dst) {
+                for (auto& kv : in) {
+                    kv.second.name = kv.first;
+                    kv.second.selfPercent = out.samples ? 100.0 * kv.second.selfSamples / out.samples : 0;
+                    kv.second.totalPercent = out.samples ? 100.0 * kv.second.totalSamples / out.samples : 0;
+                    dst.push_back(std::move(kv.second));
+                }
+                std::sort(dst.begin(), dst.end(), [](const FlatEntry& a, const FlatEntry& b) {
+                    return a.selfSamples != b.selfSamples ? a.selfSamples > b.selfSamples : a.totalSamples > b.totalSamples;
+                });
+            };
+            finish(libs, out.libraries);
+            finish(syms, out.symbols);
+            return out;
+        }
+
+        /** Folded stacks ("root;...;leaf count" per line), the input of flamegraph.pl */
+        inline std::string foldedStacks() const {
+            const uint64_t claimed = samples();
+            Symbolizer sym(stopped_ ? libraries_ : detail::LibraryRegistry::instance().snapshot());
+            sym.prime(ring_.get(), claimed, stride_, options_.maxDepth);
+            std::map<std::string, uint64_t> stacks;
+            std::string key;
+            for (uint64_t i = 0; i < claimed; ++i) {
+                const uintptr_t* rec = &ring_[i * stride_];
+                const uintptr_t depth = depthOf(rec, options_.maxDepth);
+                if (!depth) {
+                    continue;
+                }
+                key.clear();
+                for (uintptr_t d = depth; d-- > 0;) {
+                    key += sym.resolve(rec[1 + d], d == 0).symbol;
+                    if (d) {
+                        key += ';';
+                    }
+                }
+                ++stacks[key];
+            }
+            std::string out;
+            for (const auto& kv : stacks) {
+                out += kv.first;
+                out += ' ';
+                out += std::to_string(kv.second);
+                out += '\n';
+            }
+            return out;
+        }
+
+    private:
+        struct Frame {
+            std::string library;        // Managed library path or "[other]"
+            std::string symbol;         // "file!symbol" or "file+0xoffset"
+        };
+
+        /** Report-time symbolization with a per-PC cache */
+        class Symbolizer {
+        public:
+            explicit Symbolizer(std::vector<detail::LibraryRegistry::Entry> libs) : libs_(std::move(libs)) {}
+
+            /** Resolve every distinct frame of the ring through one lookupSymbols() batch */
+            inline void prime(const uintptr_t* ring, uint64_t samples, size_t stride, size_t maxDepth) {
+                std::vector<const void*> addrs;
+                for (uint64_t i = 0; i < samples; ++i) {
+                    const uintptr_t* rec = ring + i * stride;
+                    for (uintptr_t d = 0, n = depthOf(rec, maxDepth); d < n; ++d) {
+                        addrs.push_back(reinterpret_cast<const void*>(adjust(rec[1 + d], d == 0)));
+                    }
+                }
+                std::sort(addrs.begin(), addrs.end());
+                addrs.erase(std::unique(addrs.begin(), addrs.end()), addrs.end());
+                std::vector<SymbolInfo> infos(addrs.size());
+                lookupSymbols(addrs.data(), addrs.size(), infos.data());
+                for (size_t i = 0; i < addrs.size(); ++i) {
+                    if (!infos[i].symbol) {
+                        continue;       // Unmanaged code: dladdr() on demand
+                    }
+                    const auto at = reinterpret_cast<uintptr_t>(addrs[i]);
+                    std::string file = infos[i].library;
+                    const size_t slash = file.find_last_of('/');
+                    Frame f;
+                    f.library = libraryOf(at);
+                    f.symbol = file.substr(slash == std::string::npos ? 0 : slash + 1) + "!" + demangle(infos[i].symbol);
+                    cache_.emplace(at, std::move(f));
+                }
+            }
+
+            inline const Frame& resolve(uintptr_t pc, bool leaf) {
+                const uintptr_t at = adjust(pc, leaf);
+                auto it = cache_.find(at);
+                if (it != cache_.end()) {
+                    return it->second;
+                }
+                Frame f;
+                f.library = libraryOf(at);
+                Dl_info info;
+                if (::dladdr(reinterpret_cast<void*>(at), &info) && info.dli_fname) {
+                    std::string file = detail::isDescriptorPath(info.dli_fname) ? f.library : info.dli_fname;
+                    const size_t slash = file.find_last_of('/');
+                    file = file.substr(slash == std::string::npos ? 0 : slash + 1);
+                    if (info.dli_sname) {
+                        f.symbol = file + "!" + demangle(info.dli_sname);
+                    } else {
+                        char off[32];
+                        std::snprintf(off, sizeof(off), "+0x%llx",
+                            static_cast<unsigned long long>(at - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+                        f.symbol = file + off;
+                    }
+                } else {
+                    char raw[32];
+                    std::snprintf(raw, sizeof(raw), "0x%llx", static_cast<unsigned long long>(at));
+                    f.symbol = raw;
+                }
+                return cache_.emplace(at, std::move(f)).first->second;
+            }
+
+        private:
+            // Return addresses point past the call; step back into it
+            static inline uintptr_t adjust(uintptr_t pc, bool leaf) noexcept {
+                return leaf ? pc : pc - 1;
+            }
+
+            inline std::string libraryOf(uintptr_t at) const {
+                for (const auto& e : libs_) {
+                    if (at >= e.begin && at < e.end) {
+                        return e.path;
+                    }
+                }
+                return "[other]";
+            }
+
+            static inline std::string demangle(const char* name) {
+                int status = 0;
+                char* d = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+                std::string s = (status == 0 && d) ? d : name;
+                std::free(d);
+                return s;
+            }
+
+            std::vector<detail::LibraryRegistry::Entry> libs_;
+            std::unordered_map<uintptr_t, Frame> cache_;
+        };
+
+        /** Frames of a record; 0 until its handler has finished writing it, so reports can run while sampling */
+        static inline uintptr_t depthOf(const uintptr_t* rec, size_t maxDepth) noexcept {
+            return std::min<uintptr_t>(__atomic_load_n(&rec[0], __ATOMIC_ACQUIRE), maxDepth);
+        }
+
+        static inline std::atomic<CpuSampler*>& active() noexcept {
+            static std::atomic<CpuSampler*> sampler{ nullptr };
+            return sampler;
+        }
+
+        static inline std::atomic<int>& inFlight() noexcept {
+            static std::atomic<int> count{ 0 };
+            return count;
+        }
+
+        static void onSignal(int, siginfo_t*, void* context) {
+            const int savedErrno = errno;
+            inFlight().fetch_add(1);
+            if (CpuSampler* s = active().load()) {
+                s->capture(static_cast<ucontext_t*>(context));
+            }
+            inFlight().fetch_sub(1);
+            errno = savedErrno;
+        }
+
+        // Async-signal-safe: no locks, no allocation
+        inline void capture(const ucontext_t* uc) noexcept {
+            const uint64_t slot = next_.fetch_add(1, std::memory_order_acq_rel);
+            if (slot >= options_.capacity) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            uintptr_t* rec = &ring_[slot * stride_];
+            __atomic_store_n(&rec[0], uintptr_t(0), __ATOMIC_RELAXED);
+#if defined(__x86_64__)
+            uintptr_t pc = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+            uintptr_t fp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+            const uintptr_t sp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RSP]);
+#elif defined(__aarch64__)
+            uintptr_t pc = static_cast<uintptr_t>(uc->uc_mcontext.pc);
+            uintptr_t fp = static_cast<uintptr_t>(uc->uc_mcontext.regs[29]);
+            const uintptr_t sp = static_cast<uintptr_t>(uc->uc_mcontext.sp);
+#else
+            uintptr_t pc = 0, fp = 0, sp = 0;
+#endif
+            uintptr_t depth = 0;
+            rec[1 + depth++] = pc;
+            // Frame records {prev fp, return address}, copied out in 4 KiB windows
+            uintptr_t window[512];
+            uintptr_t winBase = 0, winLen = 0;
+            while (depth < options_.maxDepth && fp >= sp && (fp & (sizeof(void*) - 1)) == 0) {
+                if (fp < winBase || fp + 2 * sizeof(uintptr_t) > winBase + winLen) {
+                    struct iovec local = { window, sizeof(window) };
+                    struct iovec remote = { reinterpret_cast<void*>(fp), sizeof(window) };
+                    const ssize_t n = ::process_vm_readv(pid_, &local, 1, &remote, 1, 0);
+                    if (n < static_cast<ssize_t>(2 * sizeof(uintptr_t))) {
+                        break;
+                    }
+                    winBase = fp;
+                    winLen = static_cast<uintptr_t>(n);
+                }
+                const uintptr_t* rec2 = &window[(fp - winBase) / sizeof(uintptr_t)];
+                const uintptr_t next = rec2[0], ret = rec2[1];
+                if (!ret) {
+                    break;
+                }
+                rec[1 + depth++] = ret;
+                if (next <= fp) {
+                    break;      // Stacks grow down; anything else is not a frame chain
+                }
+                fp = next;
+            }
+            __atomic_store_n(&rec[0], depth, __ATOMIC_RELEASE);        // Publishes the frames
+        }
+
+        SamplerOptions options_;
+        size_t stride_;
+        std::unique_ptr<uintptr_t[]> ring_;             // capacity records of {depth, pc, ret...}
+        std::atomic<uint64_t> next_{ 0 };
+        std::atomic<uint64_t> dropped_{ 0 };
+        pid_t pid_ = 0;
+        timer_t timer_{};
+        bool hasTimer_ = false;
+        bool stopped_ = false;
+        struct sigaction previous_ {};
+        std::vector<detail::LibraryRegistry::Entry> libraries_;    // Registry as of stop()
+    };
+#endif  // SHAREDLIBRARY_ELF
+
 }
 // Namespace sharedlibrary ends
@@ -0,0 +1,246 @@
+/***************************************************************
+* SharedLibraryAudit.cpp
+*
+* LD_AUDIT module counting the symbol bindings ld.so performs (Linux).
+*
+* Every binding reported through la_symbind64 (lazy PLT fixups, and
+* with glibc >= 2.35 also the bindings done at load for BIND_NOW) is
+* counted per referencing object, per defining object, per edge
+* between the two and per symbol. The counts go to the POSIX shared
+* memory segment audit::shmName(pid), laid out as audit::Shared in
+* SharedLibrary.hpp; read them with sharedlibrary::bindingStats() in
+* the process itself or bindingStats(pid) from another one.
+*
+* Search time is an estimate: ld.so does not report its own lookup,
+* so each binding replays a GNU-hash lookup of the name over the
+* objects of the referencing namespace, in load order, up to the
+* defining object, and times that. The number of objects visited is
+* the search depth.
+*
+* Build:
+*   g++ -std=c++17 -O2 -shared -fPIC -I.. SharedLibraryAudit.cpp -o libSharedLibraryAudit.so
+*
+* Usage:
+*   LD_AUDIT=/path/to/libSharedLibraryAudit.so ./app
+*
+* The segment is unlinked when the process exits; set
+* SHAREDLIBRARY_AUDIT_KEEP=1 to leave it for reading afterwards (then
+* remove /dev/shm/sharedlibrary-audit.<pid> by hand).
+***************************************************************/
+
+#include "SharedLibrary.hpp"
+
+#if !defined(SHAREDLIBRARY_ELF) || !defined(__LP64__)
+#error "SharedLibraryAudit needs 64-bit ELF (Linux)"
+#endif
+
+namespace {
+
+namespace audit = sharedlibrary::audit;
+
+audit::Shared* shared = nullptr;
+struct link_map* maps[audit::MaxObjects];       // Object index -> link_map, for the lookup replay
+std::atomic<uint32_t> nextObject{ 0 };
+char segment[64];
+
+constexpr uintptr_t NoObject = ~uintptr_t(0);
+
+inline uint64_t nowNs() noexcept {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+inline uint32_t gnuHash(const char* name) noexcept {
+    uint32_t h = 5381;
+    for (; *name; ++name) {
+        h = h * 33 + static_cast<unsigned char>(*name);
+    }
+    return h;
+}
+
+/** The lookup ld.so does in one object: bloom filter, bucket, chain with name compares */
+inline bool lookup(const struct link_map* lm, const char* name, uint32_t hash) noexcept {
+    const ElfW(Sym)* symtab = nullptr;
+    const char* strtab = nullptr;
+    const uint32_t* table = nullptr;
+    const uintptr_t base = lm->l_addr;
+    auto fix = [base](ElfW(Addr) p) { return p < base ? p + base : p; };
+    for (const ElfW(Dyn)* d = lm->l_ld; d && d->d_tag != DT_NULL; ++d) {
+        switch (d->d_tag) {
+        case DT_SYMTAB:   symtab = reinterpret_cast<const ElfW(Sym)*>(fix(d->d_un.d_ptr)); break;
+        case DT_STRTAB:   strtab = reinterpret_cast<const char*>(fix(d->d_un.d_ptr)); break;
+        case DT_GNU_HASH: table = reinterpret_cast<const uint32_t*>(fix(d->d_un.d_ptr)); break;
+        default: break;
+        }
+    }
+    if (!symtab || !strtab || !table) {
+        return false;
+    }
+    const uint32_t nbuckets = table[0], symoffset = table[1], bloomSize = table[2], shift = table[3];
+    const auto* bloom = reinterpret_cast<const ElfW(Addr)*>(table + 4);
+    const auto* buckets = reinterpret_cast<const uint32_t*>(bloom + bloomSize);
+    const uint32_t* chain = buckets + nbuckets;
+    constexpr unsigned bits = sizeof(ElfW(Addr)) * 8;
+    if (!nbuckets || !bloomSize) {
+        return false;
+    }
+    const ElfW(Addr) word = bloom[(hash / bits) & (bloomSize - 1)];
+    if (!((word >> (hash % bits)) & (word >> ((hash >> shift) % bits)) & 1)) {
+        return false;
+    }
+    uint32_t i = buckets[hash % nbuckets];
+    if (i < symoffset) {
+        return false;
+    }
+    for (;; ++i) {
+        const uint32_t h = chain[i - symoffset];
+        if ((h | 1u) == (hash | 1u) && std::strcmp(strtab + symtab[i].st_name, name) == 0) {
+            return true;
+        }
+        if (h & 1u) {
+            return false;
+        }
+    }
+}
+
+/** Replay of the search from the head of ref's namespace to def; returns objects visited */
+inline uint64_t replay(const struct link_map* ref, const struct link_map* def, const char* name) noexcept {
+    const struct link_map* lm = ref;
+    while (lm->l_prev) {
+        lm = lm->l_prev;
+    }
+    const uint32_t hash = gnuHash(name);
+    uint64_t depth = 0;
+    for (; lm; lm = lm->l_next) {
+        ++depth;
+        volatile bool found = lookup(lm, name, hash);
+        (void)found;
+        if (lm == def) {
+            break;
+        }
+    }
+    return depth;
+}
+
+/** Open-addressed slot of key in a table of N entries; nullptr when full */
+template<class _Slot, uint32_t N>
+inline _Slot* claim(_Slot (&table)[N], uint64_t key, bool& inserted) noexcept {
+    static_assert((N & (N - 1)) == 0, "table size must be a power of two");
+    const uint64_t mixed = key * 0x9e3779b97f4a7c15ull;
+    for (uint32_t probe = 0; probe < N; ++probe) {
+        _Slot& s = table[(uint32_t(mixed >> 40) + probe) & (N - 1)];
+        uint64_t seen = s.key.load(std::memory_order_acquire);
+        if (seen == 0 && s.key.compare_exchange_strong(seen, key, std::memory_order_acq_rel)) {
+            inserted = true;
+            return &s;
+        }
+        if (seen == key) {
+            inserted = false;
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+void create() {
+    const std::string name = audit::shmName(::getpid());
+    std::snprintf(segment, sizeof(segment), "%s", name.c_str());
+    const int fd = ::shm_open(segment, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return;
+    }
+    void* p = MAP_FAILED;
+    if (::ftruncate(fd, sizeof(audit::Shared)) == 0) {
+        p = ::mmap(nullptr, sizeof(audit::Shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        ::shm_unlink(segment);
+        segment[0] = '\0';
+        return;
+    }
+    // A fresh segment is zero-filled: every counter and key starts at 0
+    shared = static_cast<audit::Shared*>(p);
+    shared->version = audit::Version;
+    std::atomic_thread_fence(std::memory_order_release);
+    shared->magic = audit::Magic;
+}
+
+__attribute__((destructor)) void destroy() {
+    if (segment[0] && !std::getenv("SHAREDLIBRARY_AUDIT_KEEP")) {
+        ::shm_unlink(segment);
+    }
+}
+
+}   // namespace
+
+extern "C" {
+
+unsigned int la_version(unsigned int version) {
+    create();
+    return version < LAV_CURRENT ? version : LAV_CURRENT;
+}
+
+unsigned int la_objopen(struct link_map* map, Lmid_t lmid, uintptr_t* cookie) {
+    (void)lmid;
+    *cookie = NoObject;
+    if (!shared) {
+        return 0;
+    }
+    const uint32_t i = nextObject.fetch_add(1, std::memory_order_relaxed);
+    if (i >= audit::MaxObjects) {
+        return 0;
+    }
+    audit::Object& o = shared->object[i];
+    const char* name = (map->l_name && *map->l_name) ? map->l_name : "/proc/self/exe";
+    std::snprintf(o.name, sizeof(o.name), "%s", name);
+    maps[i] = map;
+    *cookie = i;
+    // ld.so calls la_objopen under its load lock, so indexes are published in order
+    shared->objects.store(i + 1, std::memory_order_release);
+    return LA_FLG_BINDTO | LA_FLG_BINDFROM;
+}
+
+uintptr_t la_symbind64(Elf64_Sym* sym, unsigned int ndx, uintptr_t* refcook, uintptr_t* defcook,
+                       unsigned int* flags, const char* symname) {
+    (void)ndx;
+    *flags |= LA_SYMB_NOPLTENTER | LA_SYMB_NOPLTEXIT;
+    if (!shared || *refcook == NoObject || *defcook == NoObject) {
+        return sym->st_value;
+    }
+    const uint32_t from = static_cast<uint32_t>(*refcook), to = static_cast<uint32_t>(*defcook);
+    const uint64_t start = nowNs();
+    const uint64_t depth = replay(maps[from], maps[to], symname);
+    const uint64_t ns = nowNs() - start;
+
+    shared->binds.fetch_add(1, std::memory_order_relaxed);
+    shared->searchNs.fetch_add(ns, std::memory_order_relaxed);
+    shared->object[from].bindsFrom.fetch_add(1, std::memory_order_relaxed);
+    shared->object[from].searchNs.fetch_add(ns, std::memory_order_relaxed);
+    shared->object[from].searchDepth.fetch_add(depth, std::memory_order_relaxed);
+    shared->object[to].bindsTo.fetch_add(1, std::memory_order_relaxed);
+
+    const uint64_t edge = audit::edgeKey(from, to);
+    bool inserted = false;
+    audit::Edge* e = claim(shared->edge, edge, inserted);
+    audit::Symbol* s = claim(shared->symbol, audit::symbolKey(edge, symname), inserted);
+    if (e) {
+        e->binds.fetch_add(1, std::memory_order_relaxed);
+        e->searchNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+    if (s) {
+        if (inserted) {
+            s->edge = edge;
+            std::snprintf(s->name, sizeof(s->name), "%s", symname);
+            s->ready.store(1, std::memory_order_release);
+        }
+        s->binds.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!e || !s) {
+        shared->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    return sym->st_value;
+}
+
+}   // extern "C"
@@ -0,0 +1,432 @@
+/***************************************************************
+* ColdStartBench.cpp
+*
+* Exec-to-first-call latency of a plugin with cold page cache (Linux).
+*
+* Every run forks and re-executes this binary. Before each run the
+* library and the objects it pulls in are dropped from the page cache
+* with posix_fadvise(POSIX_FADV_DONTNEED), which needs no root (pages
+* still mapped by another process stay resident). The child times:
+*
+*   exec     parent fork -> child main()
+*   prepare  prefetch / prescan of the files (when configured)
+*   make     makeSharedLibrary(path, delayLoad = true, mode)
+*   load     loadNow()
+*   bind     batchLoad() of every symbol
+*   call     first call of the first symbol, taken as void(*)() (--call-all: every symbol, in order)
+*   total    fork -> end of first call
+*   exit     end of first call -> parent's waitpid() returns (teardown + exit)
+*
+* Build:
+*   g++ -std=c++17 -O2 -I.. ColdStartBench.cpp -o ColdStartBench -ldl -pthread
+*
+* Usage:
+*   ColdStartBench [--runs N] [--configs lazy,now,lazy+prefetch,...]
+*                  [--no-call | --call-all] [--csv FILE] LIBRARY SYMBOL [SYMBOL...]
+*
+* Config tokens, joined with '+':
+*   lazy | now   RTLD_LAZY (default) or LoadBindNow
+*   prefetch     POSIX_FADV_WILLNEED on every file, asynchronous readahead
+*   prescan      mmap(MAP_POPULATE) every file, synchronous read-in
+*   warm         skip eviction (page-cache-hot baseline)
+*   fast         LoadFastShutdownSafe + fastExit() instead of unload and return
+*
+* Function ordering, before and after:
+*   run the application with auditBindings(true), then
+*   writeSymbolOrdering("order.txt", "libplugin.so") and relink the
+*   plugin with -Wl,--symbol-ordering-file=order.txt (lld), or
+*   OrderingFormat::Sections + -ffunction-sections
+*   -Wl,--section-ordering-file=order.txt (gold). Compare both builds with
+*   --call-all and the hot symbols: the call phase shows the page faults.
+*
+***************************************************************/
+#include "../SharedLibrary.hpp"
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <set>
+
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace sharedlibrary;
+
+namespace {
+
+    const char* const kPhases[] = { "exec", "prepare", "make", "load", "bind", "call", "total", "exit" };
+    constexpr size_t kPhaseCount = sizeof(kPhases) / sizeof(kPhases[0]);
+
+    inline uint64_t monotonicNs() {
+        timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+    }
+
+    struct Config {
+        std::string name;
+        bool now = false, prefetch = false, prescan = false, warm = false, fast = false;
+    };
+
+    inline Config parseConfig(const std::string& name) {
+        Config c;
+        c.name = name;
+        size_t pos = 0;
+        while (pos <= name.size()) {
+            size_t end = name.find('+', pos);
+            if (end == std::string::npos) {
+                end = name.size();
+            }
+            const std::string token = name.substr(pos, end - pos);
+            if (token == "now") c.now = true;
+            else if (token == "lazy") c.now = false;
+            else if (token == "prefetch") c.prefetch = true;
+            else if (token == "prescan") c.prescan = true;
+            else if (token == "warm") c.warm = true;
+            else if (token == "fast") c.fast = true;
+            else throw std::invalid_argument("unknown config token: " + token);
+            pos = end + 1;
+        }
+        return c;
+    }
+
+    inline void evict(const std::string& file) {
+        int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+
+    inline void prefetch(const std::string& file) {
+        int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            ::close(fd);
+        }
+    }
+
+    inline void prescan(const std::string& file) {
+        int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ::munmap(p, size_t(st.st_size));
+            }
+        }
+        ::close(fd);
+    }
+
+    inline std::set<std::string> loadedObjects() {
+        std::set<std::string> names;
+        ::dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) {
+            if (info->dlpi_name && info->dlpi_name[0]) {
+                char real[PATH_MAX];
+                if (::realpath(info->dlpi_name, real)) {
+                    static_cast<std::set<std::string>*>(data)->insert(real);
+                }
+            }
+            return 0;
+        }, &names);
+        return names;
+    }
+
+    /** Child: print the files that loading `library` maps in, one per line */
+    inline int childList(int fd, const char* library) {
+        const std::set<std::string> before = loadedObjects();
+        auto lib = makeSharedLibrary(library);
+        lib->loadNow();
+        std::string out;
+        for (const std::string& name : loadedObjects()) {
+            if (!before.count(name)) {
+                out += name + "\n";
+            }
+        }
+        if (::write(fd, out.data(), out.size()) < 0) {
+            return 1;
+        }
+        return 0;
+    }
+
+    /** Child: one measured run, phases written to fd as nanoseconds, then teardown */
+    inline int childRun(int fd, const Config& config, uint64_t forkNs, const char* library,
+                        const std::vector<std::string>& symbols, int call, const std::vector<std::string>& files) {
+        uint64_t t[kPhaseCount] = {};
+        const uint64_t start = monotonicNs();
+        t[0] = start - forkNs;
+
+        uint64_t mark = monotonicNs();
+        for (const std::string& f : files) {
+            if (config.prescan) {
+                prescan(f);
+            } else if (config.prefetch) {
+                prefetch(f);
+            }
+        }
+        uint64_t now = monotonicNs();
+        t[1] = now - mark;
+
+        mark = now;
+        auto lib = makeSharedLibrary(library, true, (config.now ? LoadBindNow : LoadDefault) |
+                                                    (config.fast ? LoadFastShutdownSafe : LoadDefault));
+        now = monotonicNs();
+        t[2] = now - mark;
+
+        mark = now;
+        lib->loadNow();
+        now = monotonicNs();
+        t[3] = now - mark;
+
+        mark = now;
+        std::vector<void(*)()> fns(symbols.size());
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            lib->batchLoad(bind(symbols[i].c_str(), fns[i]));
+        }
+        now = monotonicNs();
+        t[4] = now - mark;
+
+        mark = now;
+        for (size_t i = 0; i < fns.size() && i < (call == 2 ? fns.size() : size_t(call)); ++i) {
+            fns[i]();
+        }
+        now = monotonicNs();
+        t[5] = now - mark;
+        t[6] = now - forkNs;
+        t[7] = now;     // Absolute; the parent turns it into the exit phase
+
+        char line[256];
+        int n = std::snprintf(line, sizeof(line), "%llu %llu %llu %llu %llu %llu %llu %llu\n",
+            (unsigned long long)t[0], (unsigned long long)t[1], (unsigned long long)t[2], (unsigned long long)t[3],
+            (unsigned long long)t[4], (unsigned long long)t[5], (unsigned long long)t[6], (unsigned long long)t[7]);
+        if (::write(fd, line, size_t(n)) != n) {
+            return 1;
+        }
+        ::close(fd);
+        if (config.fast) {
+            fastExit(0);
+        }
+        lib.reset();
+        return 0;
+    }
+
+    /** Parent: fork + exec self with args, return what the child wrote to its pipe */
+    inline std::string spawn(const std::vector<std::string>& args, uint64_t& forkNs, uint64_t* exitNs = nullptr) {
+        int fds[2];
+        if (::pipe(fds) != 0) {
+            throw std::runtime_error("pipe failed");
+        }
+        std::vector<std::string> full = args;
+        full.insert(full.begin() + 2, std::to_string(fds[1]));     // argv: exe, mode, fd, ...
+        std::vector<char*> argv;
+        for (std::string& a : full) {
+            argv.push_back(&a[0]);
+        }
+        argv.push_back(nullptr);
+
+        forkNs = monotonicNs();
+        const std::string stamp = std::to_string(forkNs);
+        for (size_t i = 0; i < full.size(); ++i) {
+            if (full[i] == "@FORK") {
+                argv[i] = const_cast<char*>(stamp.c_str());
+            }
+        }
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(fds[0]);
+            ::execv("/proc/self/exe", argv.data());
+            ::_exit(127);
+        }
+        ::close(fds[1]);
+        std::string out;
+        char buf[4096];
+        ssize_t n;
+        while ((n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+            out.append(buf, size_t(n));
+        }
+        ::close(fds[0]);
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        if (exitNs) {
+            *exitNs = monotonicNs();
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            throw std::runtime_error("child run failed");
+        }
+        return out;
+    }
+
+    inline double percentile(const std::vector<uint64_t>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        const size_t i = std::min(sorted.size() - 1, size_t(p * double(sorted.size() - 1) + 0.5));
+        return double(sorted[i]);
+    }
+
+    inline void report(const Config& config, std::vector<std::vector<uint64_t>> samples) {
+        std::printf("\nconfig=%s runs=%zu (microseconds)\n", config.name.c_str(), samples[0].size());
+        std::printf("%-8s %10s %10s %10s %10s %10s %10s %10s\n", "phase", "min", "p10", "p50", "p90", "p99", "max", "mean");
+        for (size_t p = 0; p < kPhaseCount; ++p) {
+            std::vector<uint64_t>& v = samples[p];
+            std::sort(v.begin(), v.end());
+            double sum = 0;
+            for (uint64_t x : v) {
+                sum += double(x);
+            }
+            std::printf("%-8s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", kPhases[p],
+                percentile(v, 0) / 1e3, percentile(v, 0.10) / 1e3, percentile(v, 0.50) / 1e3,
+                percentile(v, 0.90) / 1e3, percentile(v, 0.99) / 1e3, percentile(v, 1) / 1e3,
+                v.empty() ? 0.0 : sum / double(v.size()) / 1e3);
+        }
+    }
+
+    [[noreturn]] inline void usage() {
+        std::fprintf(stderr,
+            "usage: ColdStartBench [--runs N] [--configs lazy,now,...] [--no-call | --call-all] [--csv FILE] LIBRARY SYMBOL [SYMBOL...]\n");
+        std::exit(2);
+    }
+
+}   // namespace
+
+int main(int argc, char** argv) {
+    try {
+        // Child modes: --list FD LIB | --run FD CONFIG FORKNS CALL LIB NSYMS SYMS... FILES...
+        if (argc >= 4 && std::strcmp(argv[1], "--list") == 0) {
+            return childList(std::atoi(argv[2]), argv[3]);
+        }
+        if (argc >= 8 && std::strcmp(argv[1], "--run") == 0) {
+            const int fd = std::atoi(argv[2]);
+            const Config config = parseConfig(argv[3]);
+            const uint64_t forkNs = std::strtoull(argv[4], nullptr, 10);
+            const int call = std::strcmp(argv[5], "all") == 0 ? 2 : std::atoi(argv[5]);
+            const char* library = argv[6];
+            const int nsyms = std::atoi(argv[7]);
+            std::vector<std::string> symbols(argv + 8, argv + 8 + nsyms);
+            std::vector<std::string> files(argv + 8 + nsyms, argv + argc);
+            return childRun(fd, config, forkNs, library, symbols, call, files);
+        }
+
+        int runs = 20;
+        int call = 1;       // Symbols called: 0, the first, or 2 = all
+        std::string csvPath;
+        std::vector<Config> configs;
+        std::vector<std::string> positional;
+        for (int i = 1; i < argc; ++i) {
+            const std::string a = argv[i];
+            if (a == "--runs" && i + 1 < argc) {
+                runs = std::max(1, std::atoi(argv[++i]));
+            } else if (a == "--configs" && i + 1 < argc) {
+                std::string list = argv[++i];
+                size_t pos = 0;
+                while (pos <= list.size()) {
+                    size_t end = list.find(',', pos);
+                    if (end == std::string::npos) {
+                        end = list.size();
+                    }
+                    configs.push_back(parseConfig(list.substr(pos, end - pos)));
+                    pos = end + 1;
+                }
+            } else if (a == "--no-call") {
+                call = 0;
+            } else if (a == "--call-all") {
+                call = 2;
+            } else if (a == "--csv" && i + 1 < argc) {
+                csvPath = argv[++i];
+            } else if (!a.empty() && a[0] == '-') {
+                usage();
+            } else {
+                positional.push_back(a);
+            }
+        }
+        if (positional.size() < 2) {
+            usage();
+        }
+        if (configs.empty()) {
+            configs = { parseConfig("lazy"), parseConfig("now"), parseConfig("lazy+prefetch"),
+                        parseConfig("lazy+prescan"), parseConfig("lazy+warm"), parseConfig("lazy+fast") };
+        }
+        const std::string library = positional[0];
+        const std::vector<std::string> symbols(positional.begin() + 1, positional.end());
+
+        // Files to evict: everything loading the library maps in that this process has not
+        uint64_t ignored = 0;
+        std::vector<std::string> files;
+        {
+            const std::string listed = spawn({ "ColdStartBench", "--list", library }, ignored);
+            size_t pos = 0, end;
+            while ((end = listed.find('\n', pos)) != std::string::npos) {
+                files.push_back(listed.substr(pos, end - pos));
+                pos = end + 1;
+            }
+        }
+        std::printf("library %s: %zu file(s) evicted per run\n", library.c_str(), files.size());
+        for (const std::string& f : files) {
+            std::printf("  %s\n", f.c_str());
+        }
+
+        std::FILE* csv = csvPath.empty() ? nullptr : std::fopen(csvPath.c_str(), "w");
+        if (csv) {
+            std::fprintf(csv, "config,run");
+            for (const char* phase : kPhases) {
+                std::fprintf(csv, ",%s_ns", phase);
+            }
+            std::fprintf(csv, "\n");
+        }
+
+        for (const Config& config : configs) {
+            std::vector<std::vector<uint64_t>> samples(kPhaseCount);
+            for (int r = 0; r < runs; ++r) {
+                if (!config.warm) {
+                    for (const std::string& f : files) {
+                        evict(f);
+                    }
+                }
+                std::vector<std::string> args = { "ColdStartBench", "--run", config.name, "@FORK", call == 2 ? "all" : std::to_string(call),
+                                                   library, std::to_string(symbols.size()) };
+                args.insert(args.end(), symbols.begin(), symbols.end());
+                args.insert(args.end(), files.begin(), files.end());
+                uint64_t forkNs = 0, exitNs = 0;
+                const std::string line = spawn(args, forkNs, &exitNs);
+                unsigned long long t[kPhaseCount] = {};
+                if (std::sscanf(line.c_str(), "%llu %llu %llu %llu %llu %llu %llu %llu",
+                                &t[0], &t[1], &t[2], &t[3], &t[4], &t[5], &t[6], &t[7]) != int(kPhaseCount)) {
+                    throw std::runtime_error("malformed child report: " + line);
+                }
+                t[7] = exitNs - t[7];
+                if (csv) {
+                    std::fprintf(csv, "%s,%d", config.name.c_str(), r);
+                }
+                for (size_t p = 0; p < kPhaseCount; ++p) {
+                    samples[p].push_back(t[p]);
+                    if (csv) {
+                        std::fprintf(csv, ",%llu", t[p]);
+                    }
+                }
+                if (csv) {
+                    std::fprintf(csv, "\n");
+                }
+            }
+            report(config, std::move(samples));
+        }
+        if (csv) {
+            std::fclose(csv);
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "ColdStartBench: %s\n", e.what());
+        return 1;
+    }
+}
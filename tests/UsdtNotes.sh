@@ -0,0 +1,59 @@
+#!/bin/sh
+#***************************************************************
+# UsdtNotes.sh
+#
+# Checks that a binary using SharedLibrary.hpp carries the USDT notes
+# (Linux x86-64/AArch64): one .note.stapsdt entry of provider
+# "sharedlibrary" per probe, and the .probes semaphores, in both an
+# executable and a -fPIC shared object.
+#
+# Usage (from this directory; needs a C++17 compiler and readelf):
+#   ./UsdtNotes.sh [CXX]
+#
+# Exits non-zero, naming the missing probes, on failure.
+#***************************************************************
+set -eu
+
+CXX=${1:-${CXX:-g++}}
+HERE=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+PROBES="load native__load reload resolve resolve__miss batch__load unload"
+
+# Every probe site is reached through the public API
+cat > "$WORK/probes.cpp" <<'CPP'
+#include "SharedLibrary.hpp"
+using namespace sharedlibrary;
+int useProbes(const char* path) {
+    auto lib = makeSharedLibrary(path, true);
+    lib->loadNow();
+    int (*fn)() = nullptr;
+    lib->batchLoad(bind("f", fn));
+    void* missing = lib->tryGet<void*>("g");
+    lib->unload();
+    return fn != nullptr && missing == nullptr;
+}
+CPP
+printf 'int useProbes(const char*);\nint main(int argc, char** argv) { return argc > 1 ? useProbes(argv[1]) : 0; }\n' > "$WORK/main.cpp"
+
+"$CXX" -std=c++17 -O2 -I"$HERE/.." "$WORK/probes.cpp" "$WORK/main.cpp" -o "$WORK/app" -ldl -pthread
+"$CXX" -std=c++17 -O2 -fPIC -shared -I"$HERE/.." "$WORK/probes.cpp" -o "$WORK/libprobes.so" -ldl -pthread
+
+status=0
+for bin in "$WORK/app" "$WORK/libprobes.so"; do
+    notes=$(readelf -n "$bin")
+    for probe in $PROBES; do
+        # readelf prints "Provider: sharedlibrary" then "Name: <probe>" for each stapsdt note
+        if ! printf '%s\n' "$notes" | grep -A1 'Provider: sharedlibrary$' | grep -q "Name: $probe\$"; then
+            echo "FAIL $(basename "$bin"): no USDT note for sharedlibrary:$probe"
+            status=1
+        fi
+    done
+    if ! readelf -S "$bin" | grep -q '\.probes'; then
+        echo "FAIL $(basename "$bin"): no .probes semaphore section"
+        status=1
+    fi
+done
+[ "$status" -eq 0 ] && echo "OK: $(echo $PROBES | wc -w) sharedlibrary probes in executable and shared object"
+exit "$status"